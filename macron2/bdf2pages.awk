@@ -0,0 +1,217 @@
+#!/usr/bin/awk -f
+#
+# Copyright (c) 2023 TK Chia
+#
+# This Source Code Form is subject to the terms of the Mozilla Public
+# License, v. 2.0. If a copy of the MPL was not distributed with this
+# file, You can obtain one at http://mozilla.org/MPL/2.0/.
+#
+# Convert an 8-pixel-wide BDF font into C tables for the stage 2 console.
+#
+#	awk -f bdf2pages.awk [X=prefix] [EXTRA=comment] font.bdf >font.c
+#
+# Glyphs are looked up through a two-level table:
+#
+#	glyph = X_glyphs[X_pages[X_page_dir[code >> 8]][code & 0xff]]
+#
+# Page 0 maps every code point to glyph 0, & is shared by all pages of
+# code points which the font has no glyphs for.  Glyph 0 is the font's
+# DEFAULT_CHAR, or U+FFFD if there is no DEFAULT_CHAR, or else blank.
+
+function hex(s,   i, c, v)
+{
+  v = 0
+  s = toupper(s)
+  for (i = 1; i <= length(s); ++i) {
+    c = index("0123456789ABCDEF", substr(s, i, 1))
+    if (! c)
+      break
+    v = v * 16 + c - 1
+  }
+  return v
+}
+
+function die(msg)
+{
+  print FILENAME ":" FNR ": " msg >"/dev/stderr"
+  failed = 1
+  exit 1
+}
+
+function row_comment(v,   i, s)
+{
+  s = ""
+  for (i = 128; i >= 1; i /= 2) {
+    if (v >= i) {
+      s = s "#"
+      v -= i
+    } else
+      s = s "."
+  }
+  return s
+}
+
+function print_glyph(idx, code,   r, v, n)
+{
+  n = split(glyph[code], rows, ",")
+  if (code < 0)
+    printf "  [%d] = { /* blank */\n", idx
+  else
+    printf "  [%d] = { /* U+%04X */\n", idx, code
+  for (r = 1; r <= ht; ++r) {
+    v = r <= n ? rows[r] + 0 : 0
+    printf "    0x%02x, /* %s */\n", v, row_comment(v)
+  }
+  printf "  },\n"
+}
+
+BEGIN {
+  if (X == "")
+    X = "__cons_font_default"
+  default_char = -1
+  ncomments = 0
+}
+
+/^COMMENT / || /^COPYRIGHT / {
+  comments[ncomments++] = $0
+}
+
+/^FONTBOUNDINGBOX / {
+  fw = $2 + 0
+  ht = $3 + 0
+  fx = $4 + 0
+  fy = $5 + 0
+  if (fw != 8)
+    die("font should be 8 pixels wide")
+}
+
+/^DEFAULT_CHAR / {
+  default_char = $2 + 0
+}
+
+/^STARTCHAR/ {
+  enc = -1
+  in_bitmap = 0
+}
+
+/^ENCODING / {
+  enc = $2 + 0
+}
+
+/^BBX / {
+  bw = $2 + 0
+  bh = $3 + 0
+  bx = $4 + 0
+  by = $5 + 0
+}
+
+/^BITMAP/ {
+  if (! ht)
+    die("no FONTBOUNDINGBOX before first glyph")
+  in_bitmap = 1
+  row = ht + fy - (by + bh)
+  for (r = 0; r < ht; ++r)
+    cur[r] = 0
+  next
+}
+
+/^ENDCHAR/ {
+  in_bitmap = 0
+  if (enc < 0 || enc > 1114111)
+    next
+  s = cur[0]
+  for (r = 1; r < ht; ++r)
+    s = s "," cur[r]
+  glyph[enc] = s
+  next
+}
+
+in_bitmap {
+  if (row >= 0 && row < ht) {
+    v = hex(substr($1, 1, 2))
+    for (sh = bx - fx; sh > 0; --sh)
+      v = int(v / 2)
+    cur[row] = v
+  }
+  ++row
+}
+
+END {
+  if (failed)
+    exit 1
+  def = -1
+  if (default_char >= 0 && (default_char in glyph))
+    def = default_char
+  else if (65533 in glyph)
+    def = 65533
+
+  # Assign glyph & page numbers.
+  nglyphs = 1
+  npages = 1
+  for (hi = 0; hi < 4352; ++hi) {
+    used = 0
+    for (lo = 0; lo < 256; ++lo) {
+      code = hi * 256 + lo
+      if (code in glyph) {
+	if (code == def)
+	  index_of[code] = 0
+	else {
+	  index_of[code] = nglyphs++
+	  used = 1
+	}
+      }
+    }
+    if (used)
+      page_of[hi] = npages++
+  }
+  if (npages > 256)
+    die("too many pages")
+  if (nglyphs > 65536)
+    die("too many glyphs")
+
+  print "/* ****** AUTOMATICALLY GENERATED ******"
+  print " * by bdf2pages.awk"
+  print " *"
+  print " * Command line arguments:"
+  print " * X=" X " ..." substr(FILENAME, match(FILENAME, /\/[^\/]*$/))
+  print " * "
+  print " * Font information:"
+  for (i = 0; i < ncomments; ++i)
+    print " * " comments[i]
+  if (EXTRA != "") {
+    print " * "
+    print " * Extra comments:"
+    print " * + " EXTRA
+  }
+  print " */"
+  print "#include <inttypes.h>"
+  printf "const uint8_t %s_glyphs[%d][%d] = {\n", X, nglyphs, ht
+  print_glyph(0, def)
+  for (hi = 0; hi < 4352; ++hi)
+    if (hi in page_of)
+      for (lo = 0; lo < 256; ++lo) {
+	code = hi * 256 + lo
+	if ((code in index_of) && index_of[code] != 0)
+	  print_glyph(index_of[code], code)
+      }
+  print "};"
+  printf "const uint16_t %s_pages[%d][256] = {\n", X, npages
+  print "  [0] = { 0 },"
+  for (hi = 0; hi < 4352; ++hi)
+    if (hi in page_of) {
+      printf "  [%d] = { /* U+%04X..U+%04X */\n", page_of[hi], hi * 256, \
+	     hi * 256 + 255
+      for (lo = 0; lo < 256; ++lo) {
+	code = hi * 256 + lo
+	if ((code in index_of) && index_of[code] != 0)
+	  printf "    [0x%02x] = %d,\n", lo, index_of[code]
+      }
+      print "  },"
+    }
+  print "};"
+  printf "const uint8_t %s_page_dir[0x1100] = {\n", X
+  for (hi = 0; hi < 4352; ++hi)
+    if (hi in page_of)
+      printf "  [0x%03x] = %d,\n", hi, page_of[hi]
+  print "};"
+}
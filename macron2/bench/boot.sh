@@ -0,0 +1,88 @@
+#!/bin/sh
+# Copyright (c) 2023 TK Chia
+#
+# This Source Code Form is subject to the terms of the Mozilla Public
+# License, v. 2.0. If a copy of the MPL was not distributed with this
+# file, You can obtain one at http://mozilla.org/MPL/2.0/.
+#
+# Boot latency benchmark.  Usage:
+#
+#	boot.sh RUNS TIMEOUT QEMU [QEMU-ARGS...]
+#
+# Boots QEMU RUNS times, headless, with the serial port captured to a file,
+# & with the fw_cfg file which asks stage 2 to exit through isa-debug-exit
+# once it has booted.  Each run must end with QEMU exiting with status 1
+# (isa-debug-exit with 0 written to it) within TIMEOUT seconds, & with the
+# "qemu: exiting" line on the serial port.
+#
+# Writes tab-separated values to stdout: for the time from reset to stage 2
+# saying "hello world" (its kernel log coming up), as stage 2 reports it
+# from the time stamp counter, & for each boot phase in stage 2's trace
+# table, the median & 95th percentile in microseconds.  These leave out
+# the time which QEMU itself takes to start up & to exit.
+
+set -e
+if test $# -lt 3; then
+	echo "usage: $0 RUNS TIMEOUT QEMU [QEMU-ARGS...]" >&2
+	exit 2
+fi
+runs=$1
+timeout=$2
+shift 2
+tmp=$(mktemp -d)
+trap 'rm -rf "$tmp"' EXIT
+
+i=0
+while test $i -lt "$runs"; do
+	i=$((i + 1))
+	status=0
+	timeout "$timeout" "$@" -display none -no-reboot -snapshot \
+	    -serial file:"$tmp/serial" \
+	    -device isa-debug-exit,iobase=0xf4,iosize=0x04 \
+	    -fw_cfg name=opt/macron2/exit-after-boot,string=1 \
+	    </dev/null >/dev/null 2>&1 || status=$?
+	if test $status -ne 1 || ! grep -q '^qemu: exiting' "$tmp/serial"; then
+		echo "$0: run $i failed (status $status)" >&2
+		exit 1
+	fi
+	tr -d '\r' <"$tmp/serial" | awk '
+		/^trace: hello world [0-9]+ us after reset$/ {
+			print "hello world\t" $4
+			next
+		}
+		/^trace: / && $(NF - 2) ~ /^[0-9]+$/ &&
+		    $(NF - 1) ~ /^([0-9]+|-)$/ && $NF ~ /^([0-9]+|-)$/ {
+			name = $0
+			sub (/^trace: */, "", name)
+			sub (/ +[0-9-]+ +[0-9-]+ +[0-9-]+ *$/, "", name)
+			print name "\t" $(NF - 1)
+		}' >>"$tmp/samples"
+	echo "$0: run $i/$runs done" >&2
+done
+
+awk -F '\t' '
+	$2 != "-" {
+		if (! ($1 in n)) {
+			order[++phases] = $1
+			n[$1] = 0
+		}
+		v[$1, ++n[$1]] = $2 + 0
+	}
+	function rank(p, q,  k) {
+		k = int(n[p] * q + 0.999999)
+		return k < 1 ? 1 : k
+	}
+	END {
+		print "phase\truns\tmedian_us\tp95_us"
+		for (i = 1; i <= phases; ++i) {
+			p = order[i]
+			for (j = 2; j <= n[p]; ++j) {
+				x = v[p, j]
+				for (k = j - 1; k >= 1 && v[p, k] > x; --k)
+					v[p, k + 1] = v[p, k]
+				v[p, k + 1] = x
+			}
+			print p "\t" n[p] "\t" v[p, rank(p, 0.5)] "\t" \
+			      v[p, rank(p, 0.95)]
+		}
+	}' "$tmp/samples"
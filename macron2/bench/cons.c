@@ -0,0 +1,367 @@
+/*
+ * Copyright (c) 2023 TK Chia
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+/**
+ * @fileoverview Benchmark for the stage 2 console code, built to run as an
+ * ordinary Linux program.
+ *
+ * We hand __early_init_cons (.) a fake stage 1 information block, with a
+ * video mode describing a frame buffer in malloc'd memory, & a UEFI memory
+ * map with one block of conventional memory, again from malloc.  We then
+ * time how long the console takes to process various streams of output,
+ * both with the frame buffer updated after every write, & with updates
+ * limited to CONS_FLUSH_HZ per second.
+ *
+ * Before that, we check that the scrollback buffer copes with the worst
+ * case for its line encoding, & fail if it does not.
+ *
+ * Results are written to stdout as tab-separated values, one line per
+ * test, with a header line.  An optional command line argument gives the
+ * size in bytes of each output stream.
+ */
+
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "../cons.h"
+#include "../mem.h"
+#include "../mmio.h"
+#include "../pc.h"
+#include "../stage1.h"
+#include "../tsc.h"
+
+#define ARENA_SIZE	(256 * 1024 * 1024)
+#define STREAM_SIZE	(64 * 1024)
+
+extern void __early_init_cons (const struct stage1 *);
+
+struct bench_mode
+{
+  const char *name;
+  enum efi_graphics_pixel_format format;
+  uint32_t red_mask;
+  size_t cpp;
+};
+
+struct bench_res
+{
+  unsigned short xp, yp;
+};
+
+struct bench_stream
+{
+  const char *name;
+  char *data;
+  size_t size, lines;
+};
+
+static const struct bench_mode modes[] =
+  {
+    { "bgr565", EFI_PIXEL_BIT_MASK, 0x0000f800, 2 },
+    { "bgr555", EFI_PIXEL_BIT_MASK, 0x00007c00, 2 },
+    { "bgrx8888", EFI_PIXEL_BLUE_GREEN_RED_RESERVED_8_BIT_PER_COLOR, 0, 4 },
+    { "rgbx8888", EFI_PIXEL_RED_GREEN_BLUE_RESERVED_8_BIT_PER_COLOR, 0, 4 },
+  };
+
+static const unsigned flush_rates[] = { 0, CONS_FLUSH_HZ };
+
+static const struct bench_res resolutions[] =
+  {
+    { 640, 480 },
+    { 1920, 1080 },
+    { 3840, 2160 },
+  };
+
+static void *arena;
+static size_t stream_size = STREAM_SIZE;
+
+/* Normally set up by __early_init_tsc (.), which we do not use. */
+uint64_t __tsc_hz;
+
+/* There are no page tables to change here, so just use the "direct map". */
+void *
+__mmio_map (uint64_t pa, size_t len, enum mmio_type type)
+{
+  return __early_map_memory (pa, len);
+}
+
+/*
+ * __early_map_memory (.) adds BANE to every "physical" address it is given.
+ * So describe each block of malloc'd memory to the console code by its
+ * real address minus BANE.
+ */
+static uint64_t
+bench_phys (const void *p)
+{
+  return (uint64_t) (uintptr_t) p - BANE;
+}
+
+static void *
+bench_alloc (size_t size)
+{
+  void *p = malloc (size);
+  if (! p)
+    {
+      perror ("malloc");
+      exit (1);
+    }
+  return p;
+}
+
+static double
+bench_now (void)
+{
+  struct timespec ts;
+  clock_gettime (CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/* Time the TSC against the monotonic clock for 50 ms. */
+static uint64_t
+bench_tsc_hz (void)
+{
+  double start = bench_now (), end;
+  uint64_t tsc_start = __read_tsc (), tsc_end;
+  do
+    {
+      end = bench_now ();
+      tsc_end = __read_tsc ();
+    }
+  while (end - start < 0.05);
+  return (uint64_t) ((tsc_end - tsc_start) / (end - start));
+}
+
+/* FNV-1a hash of the frame buffer contents. */
+static uint32_t
+bench_hash (const char *fb, size_t size)
+{
+  uint32_t h = 2166136261U;
+  while (size-- != 0)
+    h = (h ^ (unsigned char) *fb++) * 16777619U;
+  return h;
+}
+
+static void
+bench_append (struct bench_stream *st, const char *s)
+{
+  size_t n = strlen (s);
+  memcpy (st->data + st->size, s, n);
+  st->size += n;
+  if (n && s[n - 1] == '\n')
+    ++st->lines;
+}
+
+static bool
+bench_full (const struct bench_stream *st)
+{
+  return st->size + 256 > stream_size;
+}
+
+/* Log-like lines of plain ASCII text. */
+static void
+bench_make_ascii (struct bench_stream *st)
+{
+  unsigned i = 0;
+  char line[128];
+  while (! bench_full (st))
+    {
+      snprintf (line, sizeof line, "[%8u.%06u] usb 1-%u: new high-speed "
+		"USB device number %u using xhci_hcd\n",
+		i / 1000, i % 1000 * 997, i % 7, i % 127);
+      bench_append (st, line);
+      ++i;
+    }
+}
+
+/* Lines of UTF-8 text with 2-, 3-, & 4-byte sequences. */
+static void
+bench_make_utf8 (struct bench_stream *st)
+{
+  while (! bench_full (st))
+    bench_append (st, "Gr\xc3\xbc\xc3\x9f" "e \xe2\x80\x94 \xce\xb1\xce\xb2"
+		      "\xce\xb3 \xe2\x9c\x93 \xe6\x97\xa5\xe6\x9c\xac "
+		      "\xf0\x9f\x98\x80 fran\xc3\xa7" "ais \xe2\x82\xac"
+		      "100\n");
+}
+
+/* Lines with many escape sequences, as a colorized log would have. */
+static void
+bench_make_escape (struct bench_stream *st)
+{
+  while (! bench_full (st))
+    bench_append (st, "\x1b[1;32m  OK  \x1b[0m] Started \x1b[1m"
+		      "udev Kernel Device Manager\x1b[0m.\x1b[K\n");
+}
+
+/* One long line of ASCII with no line breaks, which wraps. */
+static void
+bench_make_wrap (struct bench_stream *st)
+{
+  size_t i = 0;
+  while (! bench_full (st))
+    {
+      st->data[st->size++] = ' ' + i % 95;
+      ++i;
+    }
+}
+
+static void
+bench_make (struct bench_stream *st, const char *name,
+	    void (*make) (struct bench_stream *))
+{
+  st->name = name;
+  st->data = bench_alloc (stream_size);
+  st->size = st->lines = 0;
+  make (st);
+}
+
+static void
+bench_run (const struct bench_mode *mode, const struct bench_res *res,
+	   const struct bench_stream *st, unsigned flush_hz)
+{
+  static struct boot_video vid;
+  static struct boot_info_range rs[2];
+  static struct efi_memory_descriptor mem_map[1];
+  struct stage1 stage1;
+  size_t fb_size = (size_t) res->yp * res->xp * mode->cpp, off;
+  char *fb = bench_alloc (fb_size);
+  double start, secs;
+  memset (fb, 0, fb_size);
+  memset (&vid, 0, sizeof vid);
+  vid.info.horizontal_resolution = res->xp;
+  vid.info.vertical_resolution = res->yp;
+  vid.info.pixels_per_scan_line = res->xp;
+  vid.info.pixel_format = mode->format;
+  vid.info.pixel_information.red_mask = htole32 (mode->red_mask);
+  vid.frame_buffer_base = bench_phys (fb);
+  rs[0].begin = bench_phys (&vid);
+  rs[0].end = rs[0].begin + sizeof vid;
+  rs[1].begin = bench_phys (st->data);
+  rs[1].end = rs[1].begin + st->size;
+  memset (mem_map, 0, sizeof mem_map);
+  mem_map[0].type = EFI_CONVENTIAL_MEMORY;
+  mem_map[0].physical_start = bench_phys (arena);
+  mem_map[0].pages = ARENA_SIZE / PAGE_SIZE;
+  memset (&stage1, 0, sizeof stage1);
+  stage1.reserve = rs;
+  stage1.reserves = 2;
+  stage1.reserve_size = sizeof rs[0];
+  stage1.mem_map = mem_map;
+  stage1.mem_map_size = sizeof mem_map;
+  stage1.mem_map_desc_size = sizeof mem_map[0];
+  stage1.video = &vid;
+  __early_init_cons (&stage1);
+  __cons_set_flush_rate (flush_hz);
+  memset (&__cons_flush_stats, 0, sizeof __cons_flush_stats);
+  start = bench_now ();
+  off = 0;
+  while (off < st->size)
+    {
+      const char *nl = memchr (st->data + off, '\n', st->size - off);
+      size_t n = nl ? (size_t) (nl - (st->data + off)) + 1 : st->size - off;
+      if (n > 4096)
+	n = 4096;
+      __cons_write (&__console, st->data + off, n);
+      off += n;
+    }
+  __cons_flush_panic ();
+  secs = bench_now () - start;
+  printf ("%s\t%s\t%u\t%u\t%u\t%zu\t%zu\t%.6f\t%.0f\t%.0f\t%" PRIu64
+	  "\t%" PRIu64 "\t%08x\n",
+	  st->name, mode->name, (unsigned) res->xp, (unsigned) res->yp,
+	  flush_hz, st->size, st->lines, secs, st->size / secs,
+	  st->lines / secs, __cons_flush_stats.flushes,
+	  __cons_flush_stats.bytes, (unsigned) bench_hash (fb, fb_size));
+  fflush (stdout);
+  free (fb);
+}
+
+/*
+ * Check that the scrollback buffer keeps lines in which every cell changes
+ * color & holds a 4-byte UTF-8 character, the worst case for its encoding.
+ * Return false if any such line does not read back intact.
+ */
+static bool
+bench_check_scrollback (void)
+{
+  enum { XN = 80, LINES = 3 };
+  static struct cons_cell line[XN], back[XN];
+  struct cons_scrollback sb;
+  size_t size = __cons_scrollback_scratch_size (XN) + LINES * XN * 16, x, i;
+  void *mem = bench_alloc (size);
+  bool ok = true;
+  for (x = 0; x < XN; ++x)
+    {
+      line[x].ch = 0x1fffff - x;
+      line[x].fg.bgr.r = x;
+      line[x].fg.bgr.g = 0xff - x;
+      line[x].fg.bgr.b = x * 3;
+      line[x].fg.bgr.x = 0xff;
+      line[x].bg = CONS_DEFAULT_BG;
+    }
+  __cons_scrollback_init (&sb, mem, size, XN);
+  for (i = 0; i < LINES; ++i)
+    __cons_scrollback_push (&sb, line);
+  if (sb.lines != LINES)
+    ok = false;
+  for (i = 1; ok && i <= LINES; ++i)
+    {
+      __cons_scrollback_get (&sb, __cons_scrollback_find (&sb, i), back);
+      for (x = 0; x < XN; ++x)
+	if (back[x].ch != line[x].ch || back[x].fg.w != line[x].fg.w
+	    || back[x].bg.w != line[x].bg.w)
+	  ok = false;
+    }
+  free (mem);
+  return ok;
+}
+
+int
+main (int argc, char **argv)
+{
+  struct bench_stream streams[4];
+  size_t i, j, k, l;
+  if (argc > 1)
+    {
+      stream_size = strtoul (argv[1], NULL, 0);
+      if (stream_size < 1024)
+	{
+	  fprintf (stderr, "%s: stream size too small\n", argv[0]);
+	  return 1;
+	}
+    }
+  if (! bench_check_scrollback ())
+    {
+      fprintf (stderr, "%s: scrollback line does not read back\n",
+	       argv[0]);
+      return 1;
+    }
+  arena = aligned_alloc (PAGE_SIZE, ARENA_SIZE);
+  if (! arena)
+    {
+      perror ("aligned_alloc");
+      return 1;
+    }
+  bench_make (&streams[0], "ascii", bench_make_ascii);
+  bench_make (&streams[1], "wrap", bench_make_wrap);
+  bench_make (&streams[2], "utf8", bench_make_utf8);
+  bench_make (&streams[3], "escape", bench_make_escape);
+  __tsc_hz = bench_tsc_hz ();
+  puts ("test\ttype\twidth\theight\tflush_hz\tbytes\tlines\tseconds\t"
+	"bytes_per_s\tlines_per_s\tflushes\tfb_bytes\tfb_hash");
+  for (i = 0; i < __ARRAYLEN (streams); ++i)
+    for (j = 0; j < __ARRAYLEN (modes); ++j)
+      for (k = 0; k < __ARRAYLEN (resolutions); ++k)
+	for (l = 0; l < __ARRAYLEN (flush_rates); ++l)
+	  bench_run (&modes[j], &resolutions[k], &streams[i],
+		     flush_rates[l]);
+  return 0;
+}
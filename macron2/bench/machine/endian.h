@@ -0,0 +1,19 @@
+/*
+ * Copyright (c) 2023 TK Chia
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+/*
+ * Stand-in for picolibc's <machine/endian.h>, for building parts of stage 2
+ * as ordinary Linux programs.  Needs _DEFAULT_SOURCE.
+ */
+
+#ifndef _H_MACRON2_BENCH_MACHINE_ENDIAN
+#define _H_MACRON2_BENCH_MACHINE_ENDIAN
+
+#include <endian.h>
+
+#endif
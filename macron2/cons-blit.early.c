@@ -0,0 +1,273 @@
+/*
+ * Copyright (c) 2023 TK Chia
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+/**
+ * @internal
+ * @fileoverview Routines for filling & copying rows of pixels, for use by
+ * the console code.  The best implementation for the current CPU is
+ * chosen at startup.
+ *
+ * When writing to the video frame buffer, the routines can use
+ * non-temporal stores, so that pixels which we will never read back do not
+ * pollute the caches.
+ */
+
+#include <stdbool.h>
+#include <string.h>
+#include "cons.h"
+
+#if defined __amd64__ && defined __GNUC__
+# include <cpuid.h>
+# include <immintrin.h>
+
+static void
+__cons_fill_head (char **dest, uint32_t pattern, size_t *len, size_t align)
+{
+  char *d = *dest;
+  size_t n = *len;
+  if (((uintptr_t) d & 2) != 0 && n >= sizeof (uint16_t))
+    {
+      uint16_t half = (uint16_t) pattern;
+      memcpy (d, &half, sizeof half);
+      d += sizeof half;
+      n -= sizeof half;
+    }
+  while (((uintptr_t) d & (align - 1)) != 0 && n >= sizeof pattern)
+    {
+      memcpy (d, &pattern, sizeof pattern);
+      d += sizeof pattern;
+      n -= sizeof pattern;
+    }
+  *dest = d;
+  *len = n;
+}
+
+static void
+__cons_fill_tail (char *dest, uint32_t pattern, size_t len)
+{
+  while (len >= sizeof pattern)
+    {
+      memcpy (dest, &pattern, sizeof pattern);
+      dest += sizeof pattern;
+      len -= sizeof pattern;
+    }
+  if (len >= sizeof (uint16_t))
+    {
+      uint16_t half = (uint16_t) pattern;
+      memcpy (dest, &half, sizeof half);
+    }
+}
+
+static void
+__cons_fill_row_sse2 (void *dest, uint32_t pattern, size_t len, bool stream)
+{
+  char *d = dest;
+  __m128i v = _mm_set1_epi32 ((int) pattern);
+  __cons_fill_head (&d, pattern, &len, sizeof v);
+  if (stream)
+    {
+      while (len >= sizeof v)
+	{
+	  _mm_stream_si128 ((__m128i *) d, v);
+	  d += sizeof v;
+	  len -= sizeof v;
+	}
+      _mm_sfence ();
+    }
+  else
+    while (len >= sizeof v)
+      {
+	_mm_store_si128 ((__m128i *) d, v);
+	d += sizeof v;
+	len -= sizeof v;
+      }
+  __cons_fill_tail (d, pattern, len);
+}
+
+static void
+__cons_copy_row_sse2 (void *dest, const void *src, size_t len, bool stream)
+{
+  char *d = dest;
+  const char *s = src;
+  size_t head = -(uintptr_t) d & (sizeof (__m128i) - 1);
+  if (! stream || len < head + sizeof (__m128i))
+    {
+      memcpy (d, s, len);
+      return;
+    }
+  memcpy (d, s, head);
+  d += head;
+  s += head;
+  len -= head;
+  while (len >= 4 * sizeof (__m128i))
+    {
+      __m128i v0 = _mm_loadu_si128 ((const __m128i *) s),
+	      v1 = _mm_loadu_si128 ((const __m128i *) s + 1),
+	      v2 = _mm_loadu_si128 ((const __m128i *) s + 2),
+	      v3 = _mm_loadu_si128 ((const __m128i *) s + 3);
+      _mm_stream_si128 ((__m128i *) d, v0);
+      _mm_stream_si128 ((__m128i *) d + 1, v1);
+      _mm_stream_si128 ((__m128i *) d + 2, v2);
+      _mm_stream_si128 ((__m128i *) d + 3, v3);
+      d += 4 * sizeof (__m128i);
+      s += 4 * sizeof (__m128i);
+      len -= 4 * sizeof (__m128i);
+    }
+  while (len >= sizeof (__m128i))
+    {
+      _mm_stream_si128 ((__m128i *) d,
+			_mm_loadu_si128 ((const __m128i *) s));
+      d += sizeof (__m128i);
+      s += sizeof (__m128i);
+      len -= sizeof (__m128i);
+    }
+  _mm_sfence ();
+  memcpy (d, s, len);
+}
+
+__attribute__ ((target ("avx2"))) static void
+__cons_fill_row_avx2 (void *dest, uint32_t pattern, size_t len, bool stream)
+{
+  char *d = dest;
+  __m256i v = _mm256_set1_epi32 ((int) pattern);
+  __cons_fill_head (&d, pattern, &len, sizeof v);
+  if (stream)
+    {
+      while (len >= sizeof v)
+	{
+	  _mm256_stream_si256 ((__m256i *) d, v);
+	  d += sizeof v;
+	  len -= sizeof v;
+	}
+      _mm_sfence ();
+    }
+  else
+    while (len >= sizeof v)
+      {
+	_mm256_store_si256 ((__m256i *) d, v);
+	d += sizeof v;
+	len -= sizeof v;
+      }
+  __cons_fill_tail (d, pattern, len);
+}
+
+__attribute__ ((target ("avx2"))) static void
+__cons_copy_row_avx2 (void *dest, const void *src, size_t len, bool stream)
+{
+  char *d = dest;
+  const char *s = src;
+  size_t head = -(uintptr_t) d & (sizeof (__m256i) - 1);
+  if (! stream || len < head + sizeof (__m256i))
+    {
+      memcpy (d, s, len);
+      return;
+    }
+  memcpy (d, s, head);
+  d += head;
+  s += head;
+  len -= head;
+  while (len >= 2 * sizeof (__m256i))
+    {
+      __m256i v0 = _mm256_loadu_si256 ((const __m256i *) s),
+	      v1 = _mm256_loadu_si256 ((const __m256i *) s + 1);
+      _mm256_stream_si256 ((__m256i *) d, v0);
+      _mm256_stream_si256 ((__m256i *) d + 1, v1);
+      d += 2 * sizeof (__m256i);
+      s += 2 * sizeof (__m256i);
+      len -= 2 * sizeof (__m256i);
+    }
+  while (len >= sizeof (__m256i))
+    {
+      _mm256_stream_si256 ((__m256i *) d,
+			   _mm256_loadu_si256 ((const __m256i *) s));
+      d += sizeof (__m256i);
+      s += sizeof (__m256i);
+      len -= sizeof (__m256i);
+    }
+  _mm_sfence ();
+  memcpy (d, s, len);
+}
+
+static bool
+__cons_have_avx2 (void)
+{
+  unsigned eax, ebx, ecx, edx;
+  uint32_t xcr0_lo, xcr0_hi;
+  if (! __get_cpuid (1, &eax, &ebx, &ecx, &edx)
+      || (ecx & bit_OSXSAVE) == 0)
+    return false;
+  /*
+   * We do not turn on AVX state saving ourselves; only use AVX2 if the
+   * firmware has already enabled the YMM registers in %xcr0.
+   */
+  __asm volatile ("xgetbv" : "=a" (xcr0_lo), "=d" (xcr0_hi) : "c" (0));
+  if ((xcr0_lo & 6) != 6)
+    return false;
+  if (! __get_cpuid_count (7, 0, &eax, &ebx, &ecx, &edx))
+    return false;
+  return (ebx & bit_AVX2) != 0;
+}
+
+/*
+ * Stage 2 does not apply its own relocations, so these pointers are only
+ * set at run time, by __cons_blit_init (.), & never statically.
+ */
+void (*__cons_fill_row) (void *, uint32_t, size_t, bool);
+void (*__cons_copy_row) (void *, const void *, size_t, bool);
+
+void
+__cons_blit_init (void)
+{
+  if (__cons_have_avx2 ())
+    {
+      __cons_fill_row = __cons_fill_row_avx2;
+      __cons_copy_row = __cons_copy_row_avx2;
+    }
+  else
+    {
+      __cons_fill_row = __cons_fill_row_sse2;
+      __cons_copy_row = __cons_copy_row_sse2;
+    }
+}
+
+#else  /* ! (__amd64__ && __GNUC__) */
+
+static void
+__cons_fill_row_c (void *dest, uint32_t pattern, size_t len, bool stream)
+{
+  char *d = dest;
+  while (len >= sizeof pattern)
+    {
+      memcpy (d, &pattern, sizeof pattern);
+      d += sizeof pattern;
+      len -= sizeof pattern;
+    }
+  if (len >= sizeof (uint16_t))
+    {
+      uint16_t half = (uint16_t) pattern;
+      memcpy (d, &half, sizeof half);
+    }
+}
+
+static void
+__cons_copy_row_c (void *dest, const void *src, size_t len, bool stream)
+{
+  memcpy (dest, src, len);
+}
+
+void (*__cons_fill_row) (void *, uint32_t, size_t, bool);
+void (*__cons_copy_row) (void *, const void *, size_t, bool);
+
+void
+__cons_blit_init (void)
+{
+  __cons_fill_row = __cons_fill_row_c;
+  __cons_copy_row = __cons_copy_row_c;
+}
+
+#endif  /* ! (__amd64__ && __GNUC__) */
@@ -1,20 +1,22 @@
 /* ****** AUTOMATICALLY GENERATED ******
- * by bdf2c-in-awk  https://gitlab.com/tkchia/bdf2c-in-awk
+ * by bdf2pages.awk
  *
  * Command line arguments:
- * NONASCII=0 SPARSE=1 X=_cons_ C=... .../8x13B.bdf
+ * X=__cons_font_default .../8x13B-ascii.bdf
  * 
  * Font information:
- * COMMENT "$ucs-fonts: 8x13B.bdf,v 1.28 2002-11-15 18:23:23+00 mgk25 Rel $"
- * COMMENT "Send bug reports to Markus Kuhn <http://www.cl.cam.ac.uk/~mgk25/>"
+ * COMMENT "ASCII glyphs U+0020..U+007E only, recovered from the earlier"
+ * COMMENT "cons-font-default.c, which bdf2c-in-awk made from 8x13B.bdf v1.28"
+ * COMMENT "with NONASCII=0.  This is NOT the full Unicode font: every other"
+ * COMMENT "code point renders as glyph 0, which is blank."
  * COPYRIGHT "Public domain font.  Share and enjoy."
  * 
  * Extra comments:
  * + xorg.freedesktop.org/releases/individual/font/font-misc-misc-1.1.1.tar.bz2
  */
 #include <inttypes.h>
-const uint8_t __cons_font_default_direct[95][13] = {
-  [0] = { /* 32 */
+const uint8_t __cons_font_default_glyphs[96][13] = {
+  [0] = { /* blank */
     0x00, /* ........ */
     0x00, /* ........ */
     0x00, /* ........ */
@@ -29,7 +31,22 @@ const uint8_t __cons_font_default_direct[95][13] = {
     0x00, /* ........ */
     0x00, /* ........ */
   },
-  [1] = { /* 33 */
+  [1] = { /* U+0020 */
+    0x00, /* ........ */
+    0x00, /* ........ */
+    0x00, /* ........ */
+    0x00, /* ........ */
+    0x00, /* ........ */
+    0x00, /* ........ */
+    0x00, /* ........ */
+    0x00, /* ........ */
+    0x00, /* ........ */
+    0x00, /* ........ */
+    0x00, /* ........ */
+    0x00, /* ........ */
+    0x00, /* ........ */
+  },
+  [2] = { /* U+0021 */
     0x00, /* ........ */
     0x18, /* ...##... */
     0x18, /* ...##... */
@@ -44,7 +61,7 @@ const uint8_t __cons_font_default_direct[95][13] = {
     0x00, /* ........ */
     0x00, /* ........ */
   },
-  [2] = { /* 34 */
+  [3] = { /* U+0022 */
     0x00, /* ........ */
     0x6c, /* .##.##.. */
     0x6c, /* .##.##.. */
@@ -59,7 +76,7 @@ const uint8_t __cons_font_default_direct[95][13] = {
     0x00, /* ........ */
     0x00, /* ........ */
   },
-  [3] = { /* 35 */
+  [4] = { /* U+0023 */
     0x00, /* ........ */
     0x00, /* ........ */
     0x6c, /* .##.##.. */
@@ -74,7 +91,7 @@ const uint8_t __cons_font_default_direct[95][13] = {
     0x00, /* ........ */
     0x00, /* ........ */
   },
-  [4] = { /* 36 */
+  [5] = { /* U+0024 */
     0x00, /* ........ */
     0x10, /* ...#.... */
     0x7c, /* .#####.. */
@@ -89,7 +106,7 @@ const uint8_t __cons_font_default_direct[95][13] = {
     0x10, /* ...#.... */
     0x00, /* ........ */
   },
-  [5] = { /* 37 */
+  [6] = { /* U+0025 */
     0x00, /* ........ */
     0xe6, /* ###..##. */
     0xa6, /* #.#..##. */
@@ -104,7 +121,7 @@ const uint8_t __cons_font_default_direct[95][13] = {
     0x00, /* ........ */
     0x00, /* ........ */
   },
-  [6] = { /* 38 */
+  [7] = { /* U+0026 */
     0x00, /* ........ */
     0x00, /* ........ */
     0x00, /* ........ */
@@ -119,7 +136,7 @@ const uint8_t __cons_font_default_direct[95][13] = {
     0x00, /* ........ */
     0x00, /* ........ */
   },
-  [7] = { /* 39 */
+  [8] = { /* U+0027 */
     0x00, /* ........ */
     0x18, /* ...##... */
     0x18, /* ...##... */
@@ -134,7 +151,7 @@ const uint8_t __cons_font_default_direct[95][13] = {
     0x00, /* ........ */
     0x00, /* ........ */
   },
-  [8] = { /* 40 */
+  [9] = { /* U+0028 */
     0x00, /* ........ */
     0x0c, /* ....##.. */
     0x18, /* ...##... */
@@ -149,7 +166,7 @@ const uint8_t __cons_font_default_direct[95][13] = {
     0x0c, /* ....##.. */
     0x00, /* ........ */
   },
-  [9] = { /* 41 */
+  [10] = { /* U+0029 */
     0x00, /* ........ */
     0x60, /* .##..... */
     0x30, /* ..##.... */
@@ -164,7 +181,7 @@ const uint8_t __cons_font_default_direct[95][13] = {
     0x60, /* .##..... */
     0x00, /* ........ */
   },
-  [10] = { /* 42 */
+  [11] = { /* U+002A */
     0x00, /* ........ */
     0x00, /* ........ */
     0x00, /* ........ */
@@ -179,7 +196,7 @@ const uint8_t __cons_font_default_direct[95][13] = {
     0x00, /* ........ */
     0x00, /* ........ */
   },
-  [11] = { /* 43 */
+  [12] = { /* U+002B */
     0x00, /* ........ */
     0x00, /* ........ */
     0x00, /* ........ */
@@ -194,7 +211,7 @@ const uint8_t __cons_font_default_direct[95][13] = {
     0x00, /* ........ */
     0x00, /* ........ */
   },
-  [12] = { /* 44 */
+  [13] = { /* U+002C */
     0x00, /* ........ */
     0x00, /* ........ */
     0x00, /* ........ */
@@ -209,7 +226,7 @@ const uint8_t __cons_font_default_direct[95][13] = {
     0x30, /* ..##.... */
     0x00, /* ........ */
   },
-  [13] = { /* 45 */
+  [14] = { /* U+002D */
     0x00, /* ........ */
     0x00, /* ........ */
     0x00, /* ........ */
@@ -224,7 +241,7 @@ const uint8_t __cons_font_default_direct[95][13] = {
     0x00, /* ........ */
     0x00, /* ........ */
   },
-  [14] = { /* 46 */
+  [15] = { /* U+002E */
     0x00, /* ........ */
     0x00, /* ........ */
     0x00, /* ........ */
@@ -239,7 +256,7 @@ const uint8_t __cons_font_default_direct[95][13] = {
     0x00, /* ........ */
     0x00, /* ........ */
   },
-  [15] = { /* 47 */
+  [16] = { /* U+002F */
     0x00, /* ........ */
     0x02, /* ......#. */
     0x06, /* .....##. */
@@ -254,7 +271,7 @@ const uint8_t __cons_font_default_direct[95][13] = {
     0x00, /* ........ */
     0x00, /* ........ */
   },
-  [16] = { /* 48 */
+  [17] = { /* U+0030 */
     0x00, /* ........ */
     0x38, /* ..###... */
     0x6c, /* .##.##.. */
@@ -269,7 +286,7 @@ const uint8_t __cons_font_default_direct[95][13] = {
     0x00, /* ........ */
     0x00, /* ........ */
   },
-  [17] = { /* 49 */
+  [18] = { /* U+0031 */
     0x00, /* ........ */
     0x18, /* ...##... */
     0x38, /* ..###... */
@@ -284,7 +301,7 @@ const uint8_t __cons_font_default_direct[95][13] = {
     0x00, /* ........ */
     0x00, /* ........ */
   },
-  [18] = { /* 50 */
+  [19] = { /* U+0032 */
     0x00, /* ........ */
     0x7c, /* .#####.. */
     0xc6, /* ##...##. */
@@ -299,7 +316,7 @@ const uint8_t __cons_font_default_direct[95][13] = {
     0x00, /* ........ */
     0x00, /* ........ */
   },
-  [19] = { /* 51 */
+  [20] = { /* U+0033 */
     0x00, /* ........ */
     0xfe, /* #######. */
     0x06, /* .....##. */
@@ -314,7 +331,7 @@ const uint8_t __cons_font_default_direct[95][13] = {
     0x00, /* ........ */
     0x00, /* ........ */
   },
-  [20] = { /* 52 */
+  [21] = { /* U+0034 */
     0x00, /* ........ */
     0x0c, /* ....##.. */
     0x1c, /* ...###.. */
@@ -329,7 +346,7 @@ const uint8_t __cons_font_default_direct[95][13] = {
     0x00, /* ........ */
     0x00, /* ........ */
   },
-  [21] = { /* 53 */
+  [22] = { /* U+0035 */
     0x00, /* ........ */
     0xfe, /* #######. */
     0xc0, /* ##...... */
@@ -344,7 +361,7 @@ const uint8_t __cons_font_default_direct[95][13] = {
     0x00, /* ........ */
     0x00, /* ........ */
   },
-  [22] = { /* 54 */
+  [23] = { /* U+0036 */
     0x00, /* ........ */
     0x3c, /* ..####.. */
     0x60, /* .##..... */
@@ -359,7 +376,7 @@ const uint8_t __cons_font_default_direct[95][13] = {
     0x00, /* ........ */
     0x00, /* ........ */
   },
-  [23] = { /* 55 */
+  [24] = { /* U+0037 */
     0x00, /* ........ */
     0xfe, /* #######. */
     0x06, /* .....##. */
@@ -374,7 +391,7 @@ const uint8_t __cons_font_default_direct[95][13] = {
     0x00, /* ........ */
     0x00, /* ........ */
   },
-  [24] = { /* 56 */
+  [25] = { /* U+0038 */
     0x00, /* ........ */
     0x7c, /* .#####.. */
     0xc6, /* ##...##. */
@@ -389,7 +406,7 @@ const uint8_t __cons_font_default_direct[95][13] = {
     0x00, /* ........ */
     0x00, /* ........ */
   },
-  [25] = { /* 57 */
+  [26] = { /* U+0039 */
     0x00, /* ........ */
     0x7c, /* .#####.. */
     0xce, /* ##..###. */
@@ -404,7 +421,7 @@ const uint8_t __cons_font_default_direct[95][13] = {
     0x00, /* ........ */
     0x00, /* ........ */
   },
-  [26] = { /* 58 */
+  [27] = { /* U+003A */
     0x00, /* ........ */
     0x00, /* ........ */
     0x00, /* ........ */
@@ -419,7 +436,7 @@ const uint8_t __cons_font_default_direct[95][13] = {
     0x00, /* ........ */
     0x00, /* ........ */
   },
-  [27] = { /* 59 */
+  [28] = { /* U+003B */
     0x00, /* ........ */
     0x00, /* ........ */
     0x00, /* ........ */
@@ -434,7 +451,7 @@ const uint8_t __cons_font_default_direct[95][13] = {
     0x30, /* ..##.... */
     0x00, /* ........ */
   },
-  [28] = { /* 60 */
+  [29] = { /* U+003C */
     0x00, /* ........ */
     0x00, /* ........ */
     0x06, /* .....##. */
@@ -449,7 +466,7 @@ const uint8_t __cons_font_default_direct[95][13] = {
     0x00, /* ........ */
     0x00, /* ........ */
   },
-  [29] = { /* 61 */
+  [30] = { /* U+003D */
     0x00, /* ........ */
     0x00, /* ........ */
     0x00, /* ........ */
@@ -464,7 +481,7 @@ const uint8_t __cons_font_default_direct[95][13] = {
     0x00, /* ........ */
     0x00, /* ........ */
   },
-  [30] = { /* 62 */
+  [31] = { /* U+003E */
     0x00, /* ........ */
     0x00, /* ........ */
     0x60, /* .##..... */
@@ -479,7 +496,7 @@ const uint8_t __cons_font_default_direct[95][13] = {
     0x00, /* ........ */
     0x00, /* ........ */
   },
-  [31] = { /* 63 */
+  [32] = { /* U+003F */
     0x00, /* ........ */
     0x7c, /* .#####.. */
     0xc6, /* ##...##. */
@@ -494,7 +511,7 @@ const uint8_t __cons_font_default_direct[95][13] = {
     0x00, /* ........ */
     0x00, /* ........ */
   },
-  [32] = { /* 64 */
+  [33] = { /* U+0040 */
     0x00, /* ........ */
     0x00, /* ........ */
     0x7c, /* .#####.. */
@@ -509,7 +526,7 @@ const uint8_t __cons_font_default_direct[95][13] = {
     0x00, /* ........ */
     0x00, /* ........ */
   },
-  [33] = { /* 65 */
+  [34] = { /* U+0041 */
     0x00, /* ........ */
     0x38, /* ..###... */
     0x7c, /* .#####.. */
@@ -524,7 +541,7 @@ const uint8_t __cons_font_default_direct[95][13] = {
     0x00, /* ........ */
     0x00, /* ........ */
   },
-  [34] = { /* 66 */
+  [35] = { /* U+0042 */
     0x00, /* ........ */
     0xfc, /* ######.. */
     0x66, /* .##..##. */
@@ -539,7 +556,7 @@ const uint8_t __cons_font_default_direct[95][13] = {
     0x00, /* ........ */
     0x00, /* ........ */
   },
-  [35] = { /* 67 */
+  [36] = { /* U+0043 */
     0x00, /* ........ */
     0x7c, /* .#####.. */
     0xe6, /* ###..##. */
@@ -554,7 +571,7 @@ const uint8_t __cons_font_default_direct[95][13] = {
     0x00, /* ........ */
     0x00, /* ........ */
   },
-  [36] = { /* 68 */
+  [37] = { /* U+0044 */
     0x00, /* ........ */
     0xfc, /* ######.. */
     0x66, /* .##..##. */
@@ -569,7 +586,7 @@ const uint8_t __cons_font_default_direct[95][13] = {
     0x00, /* ........ */
     0x00, /* ........ */
   },
-  [37] = { /* 69 */
+  [38] = { /* U+0045 */
     0x00, /* ........ */
     0xfe, /* #######. */
     0xc0, /* ##...... */
@@ -584,7 +601,7 @@ const uint8_t __cons_font_default_direct[95][13] = {
     0x00, /* ........ */
     0x00, /* ........ */
   },
-  [38] = { /* 70 */
+  [39] = { /* U+0046 */
     0x00, /* ........ */
     0xfe, /* #######. */
     0xc0, /* ##...... */
@@ -599,7 +616,7 @@ const uint8_t __cons_font_default_direct[95][13] = {
     0x00, /* ........ */
     0x00, /* ........ */
   },
-  [39] = { /* 71 */
+  [40] = { /* U+0047 */
     0x00, /* ........ */
     0x7c, /* .#####.. */
     0xc6, /* ##...##. */
@@ -614,7 +631,7 @@ const uint8_t __cons_font_default_direct[95][13] = {
     0x00, /* ........ */
     0x00, /* ........ */
   },
-  [40] = { /* 72 */
+  [41] = { /* U+0048 */
     0x00, /* ........ */
     0xc6, /* ##...##. */
     0xc6, /* ##...##. */
@@ -629,7 +646,7 @@ const uint8_t __cons_font_default_direct[95][13] = {
     0x00, /* ........ */
     0x00, /* ........ */
   },
-  [41] = { /* 73 */
+  [42] = { /* U+0049 */
     0x00, /* ........ */
     0x3c, /* ..####.. */
     0x18, /* ...##... */
@@ -644,7 +661,7 @@ const uint8_t __cons_font_default_direct[95][13] = {
     0x00, /* ........ */
     0x00, /* ........ */
   },
-  [42] = { /* 74 */
+  [43] = { /* U+004A */
     0x00, /* ........ */
     0x0e, /* ....###. */
     0x06, /* .....##. */
@@ -659,7 +676,7 @@ const uint8_t __cons_font_default_direct[95][13] = {
     0x00, /* ........ */
     0x00, /* ........ */
   },
-  [43] = { /* 75 */
+  [44] = { /* U+004B */
     0x00, /* ........ */
     0xc6, /* ##...##. */
     0xc6, /* ##...##. */
@@ -674,7 +691,7 @@ const uint8_t __cons_font_default_direct[95][13] = {
     0x00, /* ........ */
     0x00, /* ........ */
   },
-  [44] = { /* 76 */
+  [45] = { /* U+004C */
     0x00, /* ........ */
     0xc0, /* ##...... */
     0xc0, /* ##...... */
@@ -689,7 +706,7 @@ const uint8_t __cons_font_default_direct[95][13] = {
     0x00, /* ........ */
     0x00, /* ........ */
   },
-  [45] = { /* 77 */
+  [46] = { /* U+004D */
     0x00, /* ........ */
     0xc6, /* ##...##. */
     0xc6, /* ##...##. */
@@ -704,7 +721,7 @@ const uint8_t __cons_font_default_direct[95][13] = {
     0x00, /* ........ */
     0x00, /* ........ */
   },
-  [46] = { /* 78 */
+  [47] = { /* U+004E */
     0x00, /* ........ */
     0xc6, /* ##...##. */
     0xc6, /* ##...##. */
@@ -719,7 +736,7 @@ const uint8_t __cons_font_default_direct[95][13] = {
     0x00, /* ........ */
     0x00, /* ........ */
   },
-  [47] = { /* 79 */
+  [48] = { /* U+004F */
     0x00, /* ........ */
     0x7c, /* .#####.. */
     0xc6, /* ##...##. */
@@ -734,7 +751,7 @@ const uint8_t __cons_font_default_direct[95][13] = {
     0x00, /* ........ */
     0x00, /* ........ */
   },
-  [48] = { /* 80 */
+  [49] = { /* U+0050 */
     0x00, /* ........ */
     0xfc, /* ######.. */
     0xc6, /* ##...##. */
@@ -749,7 +766,7 @@ const uint8_t __cons_font_default_direct[95][13] = {
     0x00, /* ........ */
     0x00, /* ........ */
   },
-  [49] = { /* 81 */
+  [50] = { /* U+0051 */
     0x00, /* ........ */
     0x7c, /* .#####.. */
     0xc6, /* ##...##. */
@@ -764,7 +781,7 @@ const uint8_t __cons_font_default_direct[95][13] = {
     0x06, /* .....##. */
     0x00, /* ........ */
   },
-  [50] = { /* 82 */
+  [51] = { /* U+0052 */
     0x00, /* ........ */
     0xfc, /* ######.. */
     0xc6, /* ##...##. */
@@ -779,7 +796,7 @@ const uint8_t __cons_font_default_direct[95][13] = {
     0x00, /* ........ */
     0x00, /* ........ */
   },
-  [51] = { /* 83 */
+  [52] = { /* U+0053 */
     0x00, /* ........ */
     0x7c, /* .#####.. */
     0xc6, /* ##...##. */
@@ -794,7 +811,7 @@ const uint8_t __cons_font_default_direct[95][13] = {
     0x00, /* ........ */
     0x00, /* ........ */
   },
-  [52] = { /* 84 */
+  [53] = { /* U+0054 */
     0x00, /* ........ */
     0x7e, /* .######. */
     0x18, /* ...##... */
@@ -809,7 +826,7 @@ const uint8_t __cons_font_default_direct[95][13] = {
     0x00, /* ........ */
     0x00, /* ........ */
   },
-  [53] = { /* 85 */
+  [54] = { /* U+0055 */
     0x00, /* ........ */
     0xc6, /* ##...##. */
     0xc6, /* ##...##. */
@@ -824,7 +841,7 @@ const uint8_t __cons_font_default_direct[95][13] = {
     0x00, /* ........ */
     0x00, /* ........ */
   },
-  [54] = { /* 86 */
+  [55] = { /* U+0056 */
     0x00, /* ........ */
     0xc6, /* ##...##. */
     0xc6, /* ##...##. */
@@ -839,7 +856,7 @@ const uint8_t __cons_font_default_direct[95][13] = {
     0x00, /* ........ */
     0x00, /* ........ */
   },
-  [55] = { /* 87 */
+  [56] = { /* U+0057 */
     0x00, /* ........ */
     0xc6, /* ##...##. */
     0xc6, /* ##...##. */
@@ -854,7 +871,7 @@ const uint8_t __cons_font_default_direct[95][13] = {
     0x00, /* ........ */
     0x00, /* ........ */
   },
-  [56] = { /* 88 */
+  [57] = { /* U+0058 */
     0x00, /* ........ */
     0xc6, /* ##...##. */
     0xc6, /* ##...##. */
@@ -869,7 +886,7 @@ const uint8_t __cons_font_default_direct[95][13] = {
     0x00, /* ........ */
     0x00, /* ........ */
   },
-  [57] = { /* 89 */
+  [58] = { /* U+0059 */
     0x00, /* ........ */
     0x66, /* .##..##. */
     0x66, /* .##..##. */
@@ -884,7 +901,7 @@ const uint8_t __cons_font_default_direct[95][13] = {
     0x00, /* ........ */
     0x00, /* ........ */
   },
-  [58] = { /* 90 */
+  [59] = { /* U+005A */
     0x00, /* ........ */
     0xfe, /* #######. */
     0x06, /* .....##. */
@@ -899,7 +916,7 @@ const uint8_t __cons_font_default_direct[95][13] = {
     0x00, /* ........ */
     0x00, /* ........ */
   },
-  [59] = { /* 91 */
+  [60] = { /* U+005B */
     0x00, /* ........ */
     0x7c, /* .#####.. */
     0x60, /* .##..... */
@@ -914,7 +931,7 @@ const uint8_t __cons_font_default_direct[95][13] = {
     0x7c, /* .#####.. */
     0x00, /* ........ */
   },
-  [60] = { /* 92 */
+  [61] = { /* U+005C */
     0x00, /* ........ */
     0x80, /* #....... */
     0xc0, /* ##...... */
@@ -929,7 +946,7 @@ const uint8_t __cons_font_default_direct[95][13] = {
     0x00, /* ........ */
     0x00, /* ........ */
   },
-  [61] = { /* 93 */
+  [62] = { /* U+005D */
     0x00, /* ........ */
     0x7c, /* .#####.. */
     0x0c, /* ....##.. */
@@ -944,7 +961,7 @@ const uint8_t __cons_font_default_direct[95][13] = {
     0x7c, /* .#####.. */
     0x00, /* ........ */
   },
-  [62] = { /* 94 */
+  [63] = { /* U+005E */
     0x00, /* ........ */
     0x10, /* ...#.... */
     0x38, /* ..###... */
@@ -959,7 +976,7 @@ const uint8_t __cons_font_default_direct[95][13] = {
     0x00, /* ........ */
     0x00, /* ........ */
   },
-  [63] = { /* 95 */
+  [64] = { /* U+005F */
     0x00, /* ........ */
     0x00, /* ........ */
     0x00, /* ........ */
@@ -974,7 +991,7 @@ const uint8_t __cons_font_default_direct[95][13] = {
     0xfe, /* #######. */
     0x00, /* ........ */
   },
-  [64] = { /* 96 */
+  [65] = { /* U+0060 */
     0x00, /* ........ */
     0x30, /* ..##.... */
     0x18, /* ...##... */
@@ -989,7 +1006,7 @@ const uint8_t __cons_font_default_direct[95][13] = {
     0x00, /* ........ */
     0x00, /* ........ */
   },
-  [65] = { /* 97 */
+  [66] = { /* U+0061 */
     0x00, /* ........ */
     0x00, /* ........ */
     0x00, /* ........ */
@@ -1004,7 +1021,7 @@ const uint8_t __cons_font_default_direct[95][13] = {
     0x00, /* ........ */
     0x00, /* ........ */
   },
-  [66] = { /* 98 */
+  [67] = { /* U+0062 */
     0x00, /* ........ */
     0xc0, /* ##...... */
     0xc0, /* ##...... */
@@ -1019,7 +1036,7 @@ const uint8_t __cons_font_default_direct[95][13] = {
     0x00, /* ........ */
     0x00, /* ........ */
   },
-  [67] = { /* 99 */
+  [68] = { /* U+0063 */
     0x00, /* ........ */
     0x00, /* ........ */
     0x00, /* ........ */
@@ -1034,7 +1051,7 @@ const uint8_t __cons_font_default_direct[95][13] = {
     0x00, /* ........ */
     0x00, /* ........ */
   },
-  [68] = { /* 100 */
+  [69] = { /* U+0064 */
     0x00, /* ........ */
     0x06, /* .....##. */
     0x06, /* .....##. */
@@ -1049,7 +1066,7 @@ const uint8_t __cons_font_default_direct[95][13] = {
     0x00, /* ........ */
     0x00, /* ........ */
   },
-  [69] = { /* 101 */
+  [70] = { /* U+0065 */
     0x00, /* ........ */
     0x00, /* ........ */
     0x00, /* ........ */
@@ -1064,7 +1081,7 @@ const uint8_t __cons_font_default_direct[95][13] = {
     0x00, /* ........ */
     0x00, /* ........ */
   },
-  [70] = { /* 102 */
+  [71] = { /* U+0066 */
     0x00, /* ........ */
     0x3c, /* ..####.. */
     0x66, /* .##..##. */
@@ -1079,7 +1096,7 @@ const uint8_t __cons_font_default_direct[95][13] = {
     0x00, /* ........ */
     0x00, /* ........ */
   },
-  [71] = { /* 103 */
+  [72] = { /* U+0067 */
     0x00, /* ........ */
     0x00, /* ........ */
     0x00, /* ........ */
@@ -1094,7 +1111,7 @@ const uint8_t __cons_font_default_direct[95][13] = {
     0xc6, /* ##...##. */
     0x7c, /* .#####.. */
   },
-  [72] = { /* 104 */
+  [73] = { /* U+0068 */
     0x00, /* ........ */
     0xc0, /* ##...... */
     0xc0, /* ##...... */
@@ -1109,7 +1126,7 @@ const uint8_t __cons_font_default_direct[95][13] = {
     0x00, /* ........ */
     0x00, /* ........ */
   },
-  [73] = { /* 105 */
+  [74] = { /* U+0069 */
     0x00, /* ........ */
     0x00, /* ........ */
     0x18, /* ...##... */
@@ -1124,7 +1141,7 @@ const uint8_t __cons_font_default_direct[95][13] = {
     0x00, /* ........ */
     0x00, /* ........ */
   },
-  [74] = { /* 106 */
+  [75] = { /* U+006A */
     0x00, /* ........ */
     0x00, /* ........ */
     0x06, /* .....##. */
@@ -1139,7 +1156,7 @@ const uint8_t __cons_font_default_direct[95][13] = {
     0xc6, /* ##...##. */
     0x7c, /* .#####.. */
   },
-  [75] = { /* 107 */
+  [76] = { /* U+006B */
     0x00, /* ........ */
     0xc0, /* ##...... */
     0xc0, /* ##...... */
@@ -1154,7 +1171,7 @@ const uint8_t __cons_font_default_direct[95][13] = {
     0x00, /* ........ */
     0x00, /* ........ */
   },
-  [76] = { /* 108 */
+  [77] = { /* U+006C */
     0x00, /* ........ */
     0x38, /* ..###... */
     0x18, /* ...##... */
@@ -1169,7 +1186,7 @@ const uint8_t __cons_font_default_direct[95][13] = {
     0x00, /* ........ */
     0x00, /* ........ */
   },
-  [77] = { /* 109 */
+  [78] = { /* U+006D */
     0x00, /* ........ */
     0x00, /* ........ */
     0x00, /* ........ */
@@ -1184,7 +1201,7 @@ const uint8_t __cons_font_default_direct[95][13] = {
     0x00, /* ........ */
     0x00, /* ........ */
   },
-  [78] = { /* 110 */
+  [79] = { /* U+006E */
     0x00, /* ........ */
     0x00, /* ........ */
     0x00, /* ........ */
@@ -1199,7 +1216,7 @@ const uint8_t __cons_font_default_direct[95][13] = {
     0x00, /* ........ */
     0x00, /* ........ */
   },
-  [79] = { /* 111 */
+  [80] = { /* U+006F */
     0x00, /* ........ */
     0x00, /* ........ */
     0x00, /* ........ */
@@ -1214,7 +1231,7 @@ const uint8_t __cons_font_default_direct[95][13] = {
     0x00, /* ........ */
     0x00, /* ........ */
   },
-  [80] = { /* 112 */
+  [81] = { /* U+0070 */
     0x00, /* ........ */
     0x00, /* ........ */
     0x00, /* ........ */
@@ -1229,7 +1246,7 @@ const uint8_t __cons_font_default_direct[95][13] = {
     0xc0, /* ##...... */
     0xc0, /* ##...... */
   },
-  [81] = { /* 113 */
+  [82] = { /* U+0071 */
     0x00, /* ........ */
     0x00, /* ........ */
     0x00, /* ........ */
@@ -1244,7 +1261,7 @@ const uint8_t __cons_font_default_direct[95][13] = {
     0x06, /* .....##. */
     0x06, /* .....##. */
   },
-  [82] = { /* 114 */
+  [83] = { /* U+0072 */
     0x00, /* ........ */
     0x00, /* ........ */
     0x00, /* ........ */
@@ -1259,7 +1276,7 @@ const uint8_t __cons_font_default_direct[95][13] = {
     0x00, /* ........ */
     0x00, /* ........ */
   },
-  [83] = { /* 115 */
+  [84] = { /* U+0073 */
     0x00, /* ........ */
     0x00, /* ........ */
     0x00, /* ........ */
@@ -1274,7 +1291,7 @@ const uint8_t __cons_font_default_direct[95][13] = {
     0x00, /* ........ */
     0x00, /* ........ */
   },
-  [84] = { /* 116 */
+  [85] = { /* U+0074 */
     0x00, /* ........ */
     0x60, /* .##..... */
     0x60, /* .##..... */
@@ -1289,7 +1306,7 @@ const uint8_t __cons_font_default_direct[95][13] = {
     0x00, /* ........ */
     0x00, /* ........ */
   },
-  [85] = { /* 117 */
+  [86] = { /* U+0075 */
     0x00, /* ........ */
     0x00, /* ........ */
     0x00, /* ........ */
@@ -1304,7 +1321,7 @@ const uint8_t __cons_font_default_direct[95][13] = {
     0x00, /* ........ */
     0x00, /* ........ */
   },
-  [86] = { /* 118 */
+  [87] = { /* U+0076 */
     0x00, /* ........ */
     0x00, /* ........ */
     0x00, /* ........ */
@@ -1319,7 +1336,7 @@ const uint8_t __cons_font_default_direct[95][13] = {
     0x00, /* ........ */
     0x00, /* ........ */
   },
-  [87] = { /* 119 */
+  [88] = { /* U+0077 */
     0x00, /* ........ */
     0x00, /* ........ */
     0x00, /* ........ */
@@ -1334,7 +1351,7 @@ const uint8_t __cons_font_default_direct[95][13] = {
     0x00, /* ........ */
     0x00, /* ........ */
   },
-  [88] = { /* 120 */
+  [89] = { /* U+0078 */
     0x00, /* ........ */
     0x00, /* ........ */
     0x00, /* ........ */
@@ -1349,7 +1366,7 @@ const uint8_t __cons_font_default_direct[95][13] = {
     0x00, /* ........ */
     0x00, /* ........ */
   },
-  [89] = { /* 121 */
+  [90] = { /* U+0079 */
     0x00, /* ........ */
     0x00, /* ........ */
     0x00, /* ........ */
@@ -1364,7 +1381,7 @@ const uint8_t __cons_font_default_direct[95][13] = {
     0xc6, /* ##...##. */
     0x7c, /* .#####.. */
   },
-  [90] = { /* 122 */
+  [91] = { /* U+007A */
     0x00, /* ........ */
     0x00, /* ........ */
     0x00, /* ........ */
@@ -1379,7 +1396,7 @@ const uint8_t __cons_font_default_direct[95][13] = {
     0x00, /* ........ */
     0x00, /* ........ */
   },
-  [91] = { /* 123 */
+  [92] = { /* U+007B */
     0x00, /* ........ */
     0x1e, /* ...####. */
     0x30, /* ..##.... */
@@ -1394,7 +1411,7 @@ const uint8_t __cons_font_default_direct[95][13] = {
     0x1e, /* ...####. */
     0x00, /* ........ */
   },
-  [92] = { /* 124 */
+  [93] = { /* U+007C */
     0x00, /* ........ */
     0x18, /* ...##... */
     0x18, /* ...##... */
@@ -1409,7 +1426,7 @@ const uint8_t __cons_font_default_direct[95][13] = {
     0x00, /* ........ */
     0x00, /* ........ */
   },
-  [93] = { /* 125 */
+  [94] = { /* U+007D */
     0x00, /* ........ */
     0x78, /* .####... */
     0x0c, /* ....##.. */
@@ -1424,7 +1441,7 @@ const uint8_t __cons_font_default_direct[95][13] = {
     0x78, /* .####... */
     0x00, /* ........ */
   },
-  [94] = { /* 126 */
+  [95] = { /* U+007E */
     0x00, /* ........ */
     0x00, /* ........ */
     0x72, /* .###..#. */
@@ -1440,3 +1457,106 @@ const uint8_t __cons_font_default_direct[95][13] = {
     0x00, /* ........ */
   },
 };
+const uint16_t __cons_font_default_pages[2][256] = {
+  [0] = { 0 },
+  [1] = { /* U+0000..U+00FF */
+    [0x20] = 1,
+    [0x21] = 2,
+    [0x22] = 3,
+    [0x23] = 4,
+    [0x24] = 5,
+    [0x25] = 6,
+    [0x26] = 7,
+    [0x27] = 8,
+    [0x28] = 9,
+    [0x29] = 10,
+    [0x2a] = 11,
+    [0x2b] = 12,
+    [0x2c] = 13,
+    [0x2d] = 14,
+    [0x2e] = 15,
+    [0x2f] = 16,
+    [0x30] = 17,
+    [0x31] = 18,
+    [0x32] = 19,
+    [0x33] = 20,
+    [0x34] = 21,
+    [0x35] = 22,
+    [0x36] = 23,
+    [0x37] = 24,
+    [0x38] = 25,
+    [0x39] = 26,
+    [0x3a] = 27,
+    [0x3b] = 28,
+    [0x3c] = 29,
+    [0x3d] = 30,
+    [0x3e] = 31,
+    [0x3f] = 32,
+    [0x40] = 33,
+    [0x41] = 34,
+    [0x42] = 35,
+    [0x43] = 36,
+    [0x44] = 37,
+    [0x45] = 38,
+    [0x46] = 39,
+    [0x47] = 40,
+    [0x48] = 41,
+    [0x49] = 42,
+    [0x4a] = 43,
+    [0x4b] = 44,
+    [0x4c] = 45,
+    [0x4d] = 46,
+    [0x4e] = 47,
+    [0x4f] = 48,
+    [0x50] = 49,
+    [0x51] = 50,
+    [0x52] = 51,
+    [0x53] = 52,
+    [0x54] = 53,
+    [0x55] = 54,
+    [0x56] = 55,
+    [0x57] = 56,
+    [0x58] = 57,
+    [0x59] = 58,
+    [0x5a] = 59,
+    [0x5b] = 60,
+    [0x5c] = 61,
+    [0x5d] = 62,
+    [0x5e] = 63,
+    [0x5f] = 64,
+    [0x60] = 65,
+    [0x61] = 66,
+    [0x62] = 67,
+    [0x63] = 68,
+    [0x64] = 69,
+    [0x65] = 70,
+    [0x66] = 71,
+    [0x67] = 72,
+    [0x68] = 73,
+    [0x69] = 74,
+    [0x6a] = 75,
+    [0x6b] = 76,
+    [0x6c] = 77,
+    [0x6d] = 78,
+    [0x6e] = 79,
+    [0x6f] = 80,
+    [0x70] = 81,
+    [0x71] = 82,
+    [0x72] = 83,
+    [0x73] = 84,
+    [0x74] = 85,
+    [0x75] = 86,
+    [0x76] = 87,
+    [0x77] = 88,
+    [0x78] = 89,
+    [0x79] = 90,
+    [0x7a] = 91,
+    [0x7b] = 92,
+    [0x7c] = 93,
+    [0x7d] = 94,
+    [0x7e] = 95,
+  },
+};
+const uint8_t __cons_font_default_page_dir[0x1100] = {
+  [0x000] = 1,
+};
@@ -26,24 +26,137 @@
 #include <machine/endian.h>
 #include "cons.h"
 
+_Static_assert (CONS_ASSUME_CHAR_WIDTH_PX == 8,
+		"glyph rows should be exactly 1 byte wide");
+
+/**
+ * @internal
+ * Lookup table which gives, for each possible row of a glyph bitmap, the
+ * actual row of pixels to plot for a given pair of foreground & background
+ * colors, with each pixel already scaled up horizontally.  This is shared
+ * by all the drawing routines below, & is rebuilt whenever the colors,
+ * pixel format, or scale factor change.
+ */
+static union
+  {
+    uint16_t c16[UINT8_MAX + 1][CONS_ASSUME_CHAR_WIDTH_PX * CONS_MAX_SCALE];
+    uint32_t c32[UINT8_MAX + 1][CONS_ASSUME_CHAR_WIDTH_PX * CONS_MAX_SCALE];
+  } __cons_klog_lut;
+
+/**
+ * @internal
+ * Pixel format, scale factor, & colors which __cons_klog_lut was last built
+ * for.
+ */
+static struct
+  {
+    bool valid;
+    enum cons_typ type;
+    uint8_t scale;
+    cons_std_color_t fg, bg;
+  } __cons_klog_lut_key;
+
+static bool
+__cons_klog_lut_ok (const struct cons *cons,
+		    cons_std_color_t fg, cons_std_color_t bg)
+{
+  return __cons_klog_lut_key.valid
+	 && __cons_klog_lut_key.type == cons->type
+	 && __cons_klog_lut_key.scale == cons->scale
+	 && __cons_klog_lut_key.fg.w == fg.w
+	 && __cons_klog_lut_key.bg.w == bg.w;
+}
+
+static void
+__cons_klog_lut_done (const struct cons *cons,
+		      cons_std_color_t fg, cons_std_color_t bg)
+{
+  __cons_klog_lut_key.valid = true;
+  __cons_klog_lut_key.type = cons->type;
+  __cons_klog_lut_key.scale = cons->scale;
+  __cons_klog_lut_key.fg = fg;
+  __cons_klog_lut_key.bg = bg;
+}
+
+/**
+ * @internal
+ * Return the glyph bitmap for the Unicode code point WC.  The font is
+ * indexed by a two-level table: the high bits of WC select a page, & the low
+ * 8 bits select a glyph within the page.  Pages with no glyphs all point to
+ * page 0, which maps everything to the font's default glyph 0.
+ */
+static const uint8_t *
+__cons_klog_glyph (wchar_t wc)
+{
+  uint_least32_t cp = (uint_least32_t) wc;
+  uint16_t idx;
+  if (cp >= __ARRAYLEN (__cons_font_default_page_dir) * 0x100U)
+    return __cons_font_default_glyphs[0];
+  idx = __cons_font_default_pages[__cons_font_default_page_dir[cp >> 8]]
+				 [cp & 0xffU];
+  return __cons_font_default_glyphs[idx];
+}
+
 #define COLOR		uint16_t
 #define BPP		16
-#define MAPCOLOR	__cons_klog_16_map_color
-#define DRAWBITMAP	__cons_klog_16_draw_bitmap
-#define FILLRECT	__cons_klog_16_fill_rect
-#define MOVERECT	__cons_klog_16_move_rect
-#define DRAWCHAR	__cons_klog_16_draw_char
-#define ERASELINECELLS	__cons_klog_16_erase_line_cells
-#define MOVELINECELLS	__cons_klog_16_move_line_cells
+#define TYPE		CONS_BGR565
+#define MAPCOLOR	__cons_klog_bgr565_map_color
+#define MAPCOLORCACHED	__cons_klog_bgr565_map_color_cached
+#define GLYPHLUT	__cons_klog_lut.c16
+#define GETLUT		__cons_klog_bgr565_get_lut
+#define FILLRECT	__cons_klog_bgr565_fill_rect
+#define MOVERECT	__cons_klog_bgr565_move_rect
+#define DRAWCHAR	__cons_klog_bgr565_draw_char
+#define DRAWCELLS	__cons_klog_bgr565_draw_cells
+#define DRAWRUN		__cons_klog_bgr565_draw_run
+#define ERASELINECELLS	__cons_klog_bgr565_erase_line_cells
+#define MOVELINECELLS	__cons_klog_bgr565_move_line_cells
+#include "cons-klog.inc"
+
+#define COLOR		uint16_t
+#define BPP		16
+#define TYPE		CONS_BGR555
+#define MAPCOLOR	__cons_klog_bgr555_map_color
+#define MAPCOLORCACHED	__cons_klog_bgr555_map_color_cached
+#define GLYPHLUT	__cons_klog_lut.c16
+#define GETLUT		__cons_klog_bgr555_get_lut
+#define FILLRECT	__cons_klog_bgr555_fill_rect
+#define MOVERECT	__cons_klog_bgr555_move_rect
+#define DRAWCHAR	__cons_klog_bgr555_draw_char
+#define DRAWCELLS	__cons_klog_bgr555_draw_cells
+#define DRAWRUN		__cons_klog_bgr555_draw_run
+#define ERASELINECELLS	__cons_klog_bgr555_erase_line_cells
+#define MOVELINECELLS	__cons_klog_bgr555_move_line_cells
+#include "cons-klog.inc"
+
+#define COLOR		uint32_t
+#define BPP		32
+#define TYPE		CONS_BGRX8888
+#define MAPCOLOR	__cons_klog_bgrx8888_map_color
+#define MAPCOLORCACHED	__cons_klog_bgrx8888_map_color_cached
+#define GLYPHLUT	__cons_klog_lut.c32
+#define GETLUT		__cons_klog_bgrx8888_get_lut
+#define FILLRECT	__cons_klog_bgrx8888_fill_rect
+#define MOVERECT	__cons_klog_bgrx8888_move_rect
+#define DRAWCHAR	__cons_klog_bgrx8888_draw_char
+#define DRAWCELLS	__cons_klog_bgrx8888_draw_cells
+#define DRAWRUN		__cons_klog_bgrx8888_draw_run
+#define ERASELINECELLS	__cons_klog_bgrx8888_erase_line_cells
+#define MOVELINECELLS	__cons_klog_bgrx8888_move_line_cells
 #include "cons-klog.inc"
 
 #define COLOR		uint32_t
 #define BPP		32
-#define MAPCOLOR	__cons_klog_32_map_color
-#define DRAWBITMAP	__cons_klog_32_draw_bitmap
-#define FILLRECT	__cons_klog_32_fill_rect
-#define MOVERECT	__cons_klog_32_move_rect
-#define DRAWCHAR	__cons_klog_32_draw_char
-#define ERASELINECELLS	__cons_klog_32_erase_line_cells
-#define MOVELINECELLS	__cons_klog_32_move_line_cells
+#define TYPE		CONS_RGBX8888
+#define MAPCOLOR	__cons_klog_rgbx8888_map_color
+#define MAPCOLORCACHED	__cons_klog_rgbx8888_map_color_cached
+#define GLYPHLUT	__cons_klog_lut.c32
+#define GETLUT		__cons_klog_rgbx8888_get_lut
+#define FILLRECT	__cons_klog_rgbx8888_fill_rect
+#define MOVERECT	__cons_klog_rgbx8888_move_rect
+#define DRAWCHAR	__cons_klog_rgbx8888_draw_char
+#define DRAWCELLS	__cons_klog_rgbx8888_draw_cells
+#define DRAWRUN		__cons_klog_rgbx8888_draw_run
+#define ERASELINECELLS	__cons_klog_rgbx8888_erase_line_cells
+#define MOVELINECELLS	__cons_klog_rgbx8888_move_line_cells
 #include "cons-klog.inc"
@@ -0,0 +1,353 @@
+/*
+ * Copyright (c) 2023 TK Chia
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+/**
+ * @internal
+ * @fileoverview Scrollback buffer for the console.
+ *
+ * Each line is stored as a record
+ *
+ *	len (2 bytes) | ops (len bytes) | len (2 bytes)
+ *
+ * so that the ring can be walked in either direction.  Each op is one of
+ *
+ *	0x00--0x7f	op + 1 characters, each in UTF-8
+ *	0x80--0xfe	op - 0x7e copies of one character in UTF-8
+ *	0xff		new colors: fg r, g, b, then bg r, g, b
+ *
+ * Every line starts with the default colors.  Blank cells at the end of a
+ * line, in the default background color, are not stored.
+ */
+
+#include <stdbool.h>
+#include <string.h>
+#include "cons.h"
+
+enum
+{
+  SB_LIT_MAX = 0x80,
+  SB_REP = 0x7e,
+  SB_REP_MAX = 0xfe - SB_REP,
+  SB_COLORS = 0xff,
+  /*
+   * Worst case number of bytes for one character cell: a color change, a
+   * literal op, & a 4-byte UTF-8 character.
+   */
+  SB_CELL_MAX = 1 + 6 + 1 + 4
+};
+
+static size_t
+__cons_sb_wrap (const struct cons_scrollback *sb, size_t pos)
+{
+  return pos >= sb->size ? pos - sb->size : pos;
+}
+
+static size_t
+__cons_sb_back (const struct cons_scrollback *sb, size_t pos, size_t n)
+{
+  return pos >= n ? pos - n : pos + sb->size - n;
+}
+
+static void
+__cons_sb_read (const struct cons_scrollback *sb, size_t pos, void *dest,
+		size_t n)
+{
+  size_t first = sb->size - pos;
+  if (first >= n)
+    memcpy (dest, sb->buf + pos, n);
+  else
+    {
+      memcpy (dest, sb->buf + pos, first);
+      memcpy ((char *) dest + first, sb->buf, n - first);
+    }
+}
+
+static void
+__cons_sb_write (struct cons_scrollback *sb, size_t pos, const void *src,
+		 size_t n)
+{
+  size_t first = sb->size - pos;
+  if (first >= n)
+    memcpy (sb->buf + pos, src, n);
+  else
+    {
+      memcpy (sb->buf + pos, src, first);
+      memcpy (sb->buf, (const char *) src + first, n - first);
+    }
+}
+
+static size_t
+__cons_sb_len_at (const struct cons_scrollback *sb, size_t pos)
+{
+  unsigned char len[2];
+  __cons_sb_read (sb, pos, len, sizeof len);
+  return len[0] | (size_t) len[1] << 8;
+}
+
+static unsigned char *
+__cons_sb_put_utf8 (unsigned char *p, wchar_t wc)
+{
+  uint_least32_t c = (uint_least32_t) wc;
+  if (c < 0x80)
+    *p++ = c;
+  else if (c < 0x800)
+    {
+      *p++ = 0xc0 | c >> 6;
+      *p++ = 0x80 | (c & 0x3f);
+    }
+  else if (c < 0x10000)
+    {
+      *p++ = 0xe0 | c >> 12;
+      *p++ = 0x80 | (c >> 6 & 0x3f);
+      *p++ = 0x80 | (c & 0x3f);
+    }
+  else
+    {
+      *p++ = 0xf0 | (c >> 18 & 0x07);
+      *p++ = 0x80 | (c >> 12 & 0x3f);
+      *p++ = 0x80 | (c >> 6 & 0x3f);
+      *p++ = 0x80 | (c & 0x3f);
+    }
+  return p;
+}
+
+static const unsigned char *
+__cons_sb_get_utf8 (const unsigned char *p, wchar_t *wc)
+{
+  uint_least32_t c = *p++;
+  unsigned more = 0;
+  if (c >= 0xf0)
+    {
+      c &= 0x07;
+      more = 3;
+    }
+  else if (c >= 0xe0)
+    {
+      c &= 0x0f;
+      more = 2;
+    }
+  else if (c >= 0xc0)
+    {
+      c &= 0x1f;
+      more = 1;
+    }
+  while (more-- != 0)
+    c = c << 6 | (*p++ & 0x3f);
+  *wc = (wchar_t) c;
+  return p;
+}
+
+static unsigned char *
+__cons_sb_put_color (unsigned char *p, cons_std_color_t color)
+{
+  *p++ = color.bgr.r;
+  *p++ = color.bgr.g;
+  *p++ = color.bgr.b;
+  return p;
+}
+
+static const unsigned char *
+__cons_sb_get_color (const unsigned char *p, cons_std_color_t *color)
+{
+  color->bgr.r = *p++;
+  color->bgr.g = *p++;
+  color->bgr.b = *p++;
+  color->bgr.x = 0xff;
+  return p;
+}
+
+static bool
+__cons_sb_same_cell (const struct cons_cell *a, const struct cons_cell *b)
+{
+  return a->ch == b->ch && a->fg.w == b->fg.w && a->bg.w == b->bg.w;
+}
+
+/**
+ * @internal
+ * Encode the XN cells at CELL as a series of ops at OUT.  Return the number
+ * of bytes written.
+ */
+static size_t
+__cons_sb_encode (unsigned char *out, const struct cons_cell *cell,
+		  size_t xn)
+{
+  cons_std_color_t fg = CONS_DEFAULT_FG, bg = CONS_DEFAULT_BG;
+  unsigned char *p = out, *lit = NULL;
+  size_t i = 0;
+  while (xn != 0 && cell[xn - 1].ch == L' '
+	 && cell[xn - 1].bg.w == CONS_DEFAULT_BG.w)
+    --xn;
+  while (i < xn)
+    {
+      const struct cons_cell *c = &cell[i];
+      size_t rep = 1;
+      if (c->fg.w != fg.w || c->bg.w != bg.w)
+	{
+	  *p++ = SB_COLORS;
+	  p = __cons_sb_put_color (p, c->fg);
+	  p = __cons_sb_put_color (p, c->bg);
+	  fg = c->fg;
+	  bg = c->bg;
+	  lit = NULL;
+	}
+      while (i + rep < xn && rep < SB_REP_MAX
+	     && __cons_sb_same_cell (&cell[i + rep], c))
+	++rep;
+      if (rep >= 2)
+	{
+	  *p++ = SB_REP + rep;
+	  lit = NULL;
+	}
+      else if (lit && *lit < SB_LIT_MAX - 1)
+	++*lit;
+      else
+	{
+	  lit = p;
+	  *p++ = 0;
+	}
+      p = __cons_sb_put_utf8 (p, c->ch);
+      i += rep;
+    }
+  return p - out;
+}
+
+/**
+ * @internal
+ * Decode LEN bytes of ops at IN into XN cells at CELL, padding the line
+ * with blank cells.
+ */
+static void
+__cons_sb_decode (struct cons_cell *cell, size_t xn,
+		  const unsigned char *in, size_t len)
+{
+  const unsigned char *end = in + len;
+  struct cons_cell c = { L' ', CONS_DEFAULT_FG, CONS_DEFAULT_BG };
+  size_t x = 0;
+  while (in < end && x < xn)
+    {
+      unsigned op = *in++;
+      size_t n;
+      if (op == SB_COLORS)
+	{
+	  in = __cons_sb_get_color (in, &c.fg);
+	  in = __cons_sb_get_color (in, &c.bg);
+	  continue;
+	}
+      if (op >= SB_LIT_MAX)
+	{
+	  n = op - SB_REP;
+	  in = __cons_sb_get_utf8 (in, &c.ch);
+	  while (n-- != 0 && x < xn)
+	    cell[x++] = c;
+	}
+      else
+	{
+	  n = op + 1;
+	  while (n-- != 0 && x < xn)
+	    {
+	      in = __cons_sb_get_utf8 (in, &c.ch);
+	      cell[x++] = c;
+	    }
+	}
+    }
+  c.ch = L' ';
+  c.fg = CONS_DEFAULT_FG;
+  c.bg = CONS_DEFAULT_BG;
+  while (x < xn)
+    cell[x++] = c;
+}
+
+/**
+ * Return the number of bytes of scratch space, including space for one
+ * decoded line, which a scrollback buffer needs for lines of XN cells.
+ */
+size_t
+__cons_scrollback_scratch_size (size_t xn)
+{
+  return xn * (sizeof (struct cons_cell) + SB_CELL_MAX) + 4;
+}
+
+/**
+ * Set up SB to keep lines of XN cells in the SIZE bytes at MEM, which
+ * should be suitably aligned.  Some of this space is used as scratch space.
+ */
+void
+__cons_scrollback_init (struct cons_scrollback *sb, void *mem, size_t size,
+			size_t xn)
+{
+  size_t scratch_sz = __cons_scrollback_scratch_size (xn);
+  memset (sb, 0, sizeof (*sb));
+  if (! mem || size <= scratch_sz)
+    return;
+  sb->line = mem;
+  sb->scratch = (unsigned char *) (sb->line + xn);
+  sb->buf = (unsigned char *) mem + scratch_sz;
+  sb->size = size - scratch_sz;
+  sb->xn = xn;
+}
+
+/**
+ * Add the line of cells at CELLS to the end of SB, throwing away old lines
+ * if needed to make room.
+ */
+void
+__cons_scrollback_push (struct cons_scrollback *sb,
+			const struct cons_cell *cells)
+{
+  unsigned char *rec = sb->scratch;
+  size_t len, rec_sz;
+  if (! sb->buf)
+    return;
+  len = __cons_sb_encode (rec + 2, cells, sb->xn);
+  rec[0] = rec[len + 2] = len & 0xff;
+  rec[1] = rec[len + 3] = len >> 8;
+  rec_sz = len + 4;
+  if (rec_sz > sb->size)
+    return;
+  while (sb->size - sb->used < rec_sz)
+    {
+      size_t old_sz = __cons_sb_len_at (sb, sb->head) + 4;
+      sb->head = __cons_sb_wrap (sb, sb->head + old_sz);
+      sb->used -= old_sz;
+      --sb->lines;
+    }
+  __cons_sb_write (sb, __cons_sb_wrap (sb, sb->head + sb->used), rec,
+		   rec_sz);
+  sb->used += rec_sz;
+  ++sb->lines;
+}
+
+/**
+ * Return the position in SB of the line which is BACK lines before the end.
+ * BACK should be between 1 & the number of lines in SB.
+ */
+size_t
+__cons_scrollback_find (const struct cons_scrollback *sb, size_t back)
+{
+  size_t pos = __cons_sb_wrap (sb, sb->head + sb->used);
+  while (back-- != 0)
+    {
+      size_t prev = __cons_sb_back (sb, pos, 2);
+      pos = __cons_sb_back (sb, pos, __cons_sb_len_at (sb, prev) + 4);
+    }
+  return pos;
+}
+
+/**
+ * Decode the line at position POS in SB into CELLS, & return the position
+ * of the next line.
+ */
+size_t
+__cons_scrollback_get (struct cons_scrollback *sb, size_t pos,
+		       struct cons_cell *cells)
+{
+  size_t len = __cons_sb_len_at (sb, pos);
+  __cons_sb_read (sb, __cons_sb_wrap (sb, pos + 2), sb->scratch, len);
+  __cons_sb_decode (cells, sb->xn, sb->scratch, len);
+  return __cons_sb_wrap (sb, pos + len + 4);
+}
@@ -20,11 +20,74 @@
 #include <stdbool.h>
 #include <string.h>
 #include <machine/endian.h>
+#if defined __amd64__ && defined __GNUC__
+# include <emmintrin.h>
+#endif
 #include "cons.h"
+#include "mem.h"
+#include "mmio.h"
 #include "pc.h"
 #include "stage1.h"
+#include "tsc.h"
 
-struct cons __console;
+struct cons __consoles[CONS_VTS];
+struct cons_flush_stats __cons_flush_stats;
+
+/**
+ * @internal
+ * State for rate-limiting frame buffer updates: the maximum rate in Hz, the
+ * corresponding minimum number of TSC ticks between updates, & the TSC
+ * value at the last update.  If interval is 0, every flush request goes
+ * ahead at once.
+ */
+static struct
+  {
+    unsigned hz;
+    uint64_t interval, last;
+  } __cons_sched;
+
+/**
+ * @internal
+ * Smallest terminal size which we try to keep when scaling up glyphs.
+ */
+enum
+{
+  CONS_SCALE_MIN_ROWS = 40,
+  CONS_SCALE_MIN_COLS = 120
+};
+
+/**
+ * @internal
+ * Size of the static character cell grid which the boot console falls back
+ * on if it cannot allocate one for the whole screen.
+ */
+enum
+{
+  CONS_FALLBACK_ROWS = 25,
+  CONS_FALLBACK_COLS = 80
+};
+
+#define __CONS_RGB(__r, __g, __b) \
+	{ .bgr.r = (__r), .bgr.g = (__g), .bgr.b = (__b), .bgr.x = 0xff }
+
+/**
+ * @internal
+ * Colors for the 16 basic ANSI color numbers.  These follow the usual VGA
+ * text mode palette.
+ */
+static const cons_std_color_t __cons_ansi_colors[16] =
+  {
+    __CONS_RGB (0x00, 0x00, 0x00), __CONS_RGB (0xaa, 0x00, 0x00),
+    __CONS_RGB (0x00, 0xaa, 0x00), __CONS_RGB (0xaa, 0x55, 0x00),
+    __CONS_RGB (0x00, 0x00, 0xaa), __CONS_RGB (0xaa, 0x00, 0xaa),
+    __CONS_RGB (0x00, 0xaa, 0xaa), __CONS_RGB (0xaa, 0xaa, 0xaa),
+    __CONS_RGB (0x55, 0x55, 0x55), __CONS_RGB (0xff, 0x55, 0x55),
+    __CONS_RGB (0x55, 0xff, 0x55), __CONS_RGB (0xff, 0xff, 0x55),
+    __CONS_RGB (0x55, 0x55, 0xff), __CONS_RGB (0xff, 0x55, 0xff),
+    __CONS_RGB (0x55, 0xff, 0xff), __CONS_RGB (0xff, 0xff, 0xff)
+  };
+
+#undef __CONS_RGB
 
 static bool
 __cons_iscntrl (unsigned char c)
@@ -38,35 +101,199 @@ __cons_isascii (unsigned char c)
   return c <= 0x7f;
 }
 
+static size_t
+__cons_bytes_per_pixel (enum cons_typ type)
+{
+  switch (type)
+    {
+    default:
+      return sizeof (cons_bgrx_color_t);
+    case CONS_BGR565:
+    case CONS_BGR555:
+      return sizeof (cons_bgr565_color_t);
+    }
+}
+
+/**
+ * @internal
+ * Update the cached frame buffer pixel values for the current foreground &
+ * background colors.  This should be called whenever fg or bg change.
+ */
+static void
+__cons_update_colors (struct cons *cons)
+{
+  cons->fg_px = cons->map_color (cons->fg);
+  cons->bg_px = cons->map_color (cons->bg);
+}
+
+#define __CONS_SET_OPS(cons, typ) \
+	do \
+	  { \
+	    (cons)->map_color = __cons_klog_##typ##_map_color; \
+	    (cons)->draw_char = __cons_klog_##typ##_draw_char; \
+	    (cons)->draw_cells = __cons_klog_##typ##_draw_cells; \
+	    (cons)->erase_line_cells = __cons_klog_##typ##_erase_line_cells; \
+	    (cons)->move_line_cells = __cons_klog_##typ##_move_line_cells; \
+	  } \
+	while (0)
+
 static void
 __cons_set_type (struct cons *cons, enum cons_typ type)
 {
   cons->type = type;
   switch (type)
     {
-    default:
-      cons->draw_char = __cons_klog_32_draw_char;
-      cons->erase_line_cells = __cons_klog_32_erase_line_cells;
-      cons->move_line_cells = __cons_klog_32_move_line_cells;
-      break;
     case CONS_BGR565:
+      __CONS_SET_OPS (cons, bgr565);
+      break;
     case CONS_BGR555:
-      cons->draw_char = __cons_klog_16_draw_char;
-      cons->erase_line_cells = __cons_klog_16_erase_line_cells;
-      cons->move_line_cells = __cons_klog_16_move_line_cells;
+      __CONS_SET_OPS (cons, bgr555);
+      break;
+    default:
+      __CONS_SET_OPS (cons, bgrx8888);
+      break;
+    case CONS_RGBX8888:
+      __CONS_SET_OPS (cons, rgbx8888);
+    }
+  __cons_update_colors (cons);
+}
+
+#undef __CONS_SET_OPS
+
+static void
+__cons_clear_spans (struct cons_span *span, size_t n)
+{
+  while (n-- != 0)
+    {
+      span->x0 = USHRT_MAX;
+      span->x1 = 0;
+      ++span;
     }
 }
 
 static void
-__early_init_uefi_cons (struct cons *cons, const struct boot_reserve *rs)
+__cons_mark_span (struct cons_span *span, unsigned short x0,
+		  unsigned short x1)
 {
-  const struct boot_video *vid = __early_map_memory (rs->begin,
-						     rs->end - rs->begin);
+  if (span->x0 > x0)
+    span->x0 = x0;
+  if (span->x1 < x1)
+    span->x1 = x1;
+}
+
+static void
+__cons_clear_dirty (struct cons *cons)
+{
+  if (cons->dirty)
+    __cons_clear_spans (cons->dirty, cons->yn);
+}
+
+/**
+ * @internal
+ * Arrange to give the console a canvas in main memory, separate from the
+ * frame buffer.  If this is not possible, just draw directly into the frame
+ * buffer.
+ */
+static void
+__early_init_canvas (struct cons *cons, const struct stage1 *stage1)
+{
+  size_t cpp = __cons_bytes_per_pixel (cons->type),
+	 xs = cons->xp * cpp, canvas_sz = cons->yp * xs,
+	 dirty_sz = cons->yn * sizeof (struct cons_span);
+  char *mem = __early_alloc_pages (stage1, (canvas_sz + dirty_sz
+					    + PAGE_SIZE - 1) / PAGE_SIZE);
+  if (! mem)
+    {
+      cons->canvas = cons->fb;
+      cons->xs = cons->xsfb;
+      cons->dirty = NULL;
+      return;
+    }
+  cons->canvas = mem;
+  cons->xs = xs;
+  cons->dirty = (struct cons_span *) (mem + canvas_sz);
+  __cons_clear_dirty (cons);
+}
+
+/**
+ * @internal
+ * Allocate the console's character cell grid.  Return false if this is not
+ * possible.
+ */
+static bool
+__early_init_cells (struct cons *cons, const struct stage1 *stage1)
+{
+  size_t cells_sz = (size_t) cons->yn * cons->xn * sizeof (struct cons_cell),
+	 dirty_sz = cons->yn * sizeof (struct cons_span);
+  char *mem = __early_alloc_pages (stage1, (cells_sz + dirty_sz
+					    + PAGE_SIZE - 1) / PAGE_SIZE);
+  if (! mem)
+    return false;
+  cons->cells = (struct cons_cell *) mem;
+  cons->cells_dirty = (struct cons_span *) (mem + cells_sz);
+  return true;
+}
+
+/**
+ * @internal
+ * Give the boot console a small static character cell grid, for when there
+ * is no memory for one which covers the whole screen.  The terminal then
+ * only takes up the top left corner of the screen, but still shows output.
+ */
+static void
+__early_init_fallback_cells (struct cons *cons)
+{
+  static struct cons_cell cells[CONS_FALLBACK_ROWS * CONS_FALLBACK_COLS];
+  static struct cons_span cells_dirty[CONS_FALLBACK_ROWS];
+  if (cons->yn > CONS_FALLBACK_ROWS)
+    cons->yn = CONS_FALLBACK_ROWS;
+  if (cons->xn > CONS_FALLBACK_COLS)
+    cons->xn = CONS_FALLBACK_COLS;
+  cons->cells = cells;
+  cons->cells_dirty = cells_dirty;
+}
+
+/**
+ * @internal
+ * Give the console a scrollback buffer of CONS_SCROLLBACK_SIZE bytes.  If
+ * this is not possible, just do without.
+ */
+static void
+__early_init_scrollback (struct cons *cons, const struct stage1 *stage1)
+{
+  size_t sb_sz = CONS_SCROLLBACK_SIZE;
+  void *mem = __early_alloc_pages (stage1, (sb_sz + PAGE_SIZE - 1)
+					   / PAGE_SIZE);
+  __cons_scrollback_init (&cons->sb, mem, sb_sz, cons->xn);
+}
+
+/**
+ * @internal
+ * Choose how much to scale up glyphs on a screen of YP * XP pixels: the
+ * largest factor, up to CONS_MAX_SCALE, which still leaves room for at
+ * least CONS_SCALE_MIN_ROWS lines of CONS_SCALE_MIN_COLS characters.
+ */
+static unsigned
+__cons_choose_scale (unsigned short yp, unsigned short xp)
+{
+  unsigned scale = CONS_MAX_SCALE;
+  while (scale > 1
+	 && (yp / (CONS_ASSUME_CHAR_HEIGHT_PX * scale) < CONS_SCALE_MIN_ROWS
+	     || xp / (CONS_ASSUME_CHAR_WIDTH_PX * scale) < CONS_SCALE_MIN_COLS))
+    --scale;
+  return scale;
+}
+
+static bool
+__early_init_uefi_cons (struct cons *cons, const struct stage1 *stage1)
+{
+  const struct boot_video *vid = stage1->video;
   unsigned short yp = vid->info.vertical_resolution;
   unsigned short xp = vid->info.horizontal_resolution;
   size_t cpp = sizeof (cons_bgrx_color_t);  /* `char's per pixel */
   unsigned short xs = vid->info.pixels_per_scan_line;  /* to be scaled */
   enum cons_typ type = CONS_BGRX8888;  /* assume BGRX if format unknown */
+  unsigned scale;
   char *fb;
   switch (vid->info.pixel_format)
     {
@@ -99,14 +326,32 @@ __early_init_uefi_cons (struct cons *cons, const struct boot_reserve *rs)
       }
     }
   xs *= cpp;
-  cons->yn = yp / CONS_ASSUME_CHAR_HEIGHT_PX;
-  cons->xn = xp / CONS_ASSUME_CHAR_WIDTH_PX;
+  scale = __cons_choose_scale (yp, xp);
+  cons->scale = scale;
+  cons->yc = CONS_ASSUME_CHAR_HEIGHT_PX * scale;
+  cons->xc = CONS_ASSUME_CHAR_WIDTH_PX * scale;
+  cons->yn = yp / cons->yc;
+  cons->xn = xp / cons->xc;
   cons->yp = yp;
   cons->xp = xp;
   cons->xs = cons->xsfb = xs;
   __cons_set_type (cons, type);
-  fb = __early_map_memory (vid->frame_buffer_base, yp * xs);
-  cons->fb = cons->canvas = fb;
+  /*
+   * The direct map at BANE only covers RAM, so the frame buffer must go
+   * through the MMIO window.  If someone has already mapped it as
+   * uncacheable, use that; drawing is slower, but still works.
+   */
+  fb = __mmio_map (vid->frame_buffer_base, yp * xs, MMIO_WC);
+  if (! fb)
+    fb = __mmio_map (vid->frame_buffer_base, yp * xs, MMIO_UC);
+  if (! fb)
+    return false;
+  if (! __early_init_cells (cons, stage1))
+    __early_init_fallback_cells (cons);
+  __early_init_scrollback (cons, stage1);
+  cons->fb = fb;
+  __early_init_canvas (cons, stage1);
+  return true;
 }
 
 static void
@@ -114,19 +359,43 @@ __early_init_dummy_cons (struct cons *cons)
 {
   static char dummy_fb[CONS_ASSUME_CHAR_HEIGHT_PX * CONS_ASSUME_CHAR_WIDTH_PX
 		       * sizeof (cons_bgrx_color_t)];
+  static struct cons_cell dummy_cell;
+  static struct cons_span dummy_cell_dirty;
   cons->yn = cons->xn = 1;
-  cons->yp = CONS_ASSUME_CHAR_HEIGHT_PX;
+  cons->scale = 1;
+  cons->yc = cons->yp = CONS_ASSUME_CHAR_HEIGHT_PX;
+  cons->xc = CONS_ASSUME_CHAR_WIDTH_PX;
   cons->xp = cons->xs = cons->xsfb = CONS_ASSUME_CHAR_WIDTH_PX;
   __cons_set_type (cons, CONS_BGRX8888);
   cons->fb = cons->canvas = dummy_fb;
+  cons->dirty = NULL;
+  cons->cells = &dummy_cell;
+  cons->cells_dirty = &dummy_cell_dirty;
 }
 
 static void
-__cons_reset_output_mode (struct cons *cons)
+__cons_reset_attrs (struct cons *cons)
 {
-  cons->state = TTY_NORM;
   cons->fg = CONS_DEFAULT_FG;
   cons->bg = CONS_DEFAULT_BG;
+  cons->fg_ansi = 7;
+  cons->bold = cons->reverse = false;
+  __cons_update_colors (cons);
+}
+
+static void
+__cons_reset_output_mode (struct cons *cons)
+{
+  cons->state = TTY_NORM;
+  __cons_reset_attrs (cons);
+}
+
+static void
+__cons_blank_cells (struct cons *cons, struct cons_cell *cell, size_t n)
+{
+  struct cons_cell blank = { L' ', cons->fg, cons->bg };
+  while (n-- != 0)
+    *cell++ = blank;
 }
 
 static void
@@ -134,36 +403,123 @@ __cons_full_reset (struct cons *cons)
 {
   __cons_reset_output_mode (cons);
   cons->y = cons->x = 0;
-  memset (cons->fb, 0, cons->yp * cons->xs);
+  cons->saved_y = cons->saved_x = 0;
+  cons->red_zone = false;
+  cons->scroll_top = 0;
+  cons->scroll_bot = cons->yn;
+  cons->top = cons->scrolled = 0;
+  cons->view = 0;
+  __cons_blank_cells (cons, cons->cells, (size_t) cons->yn * cons->xn);
+  __cons_clear_spans (cons->cells_dirty, cons->yn);
+  if (! cons->active)
+    return;
+  memset (cons->fb, 0, cons->yp * cons->xsfb);
+  if (cons->canvas != cons->fb)
+    memset (cons->canvas, 0, cons->yp * cons->xs);
+  __cons_clear_dirty (cons);
 }
 
 static void
 __early_init_cons_1 (struct cons *cons, const struct stage1 *stage1)
 {
-  const struct boot_reserve *rs;
-  size_t nr;
   memset (cons, 0, sizeof (*cons));
-  rs = stage1->reserve;
-  nr = stage1->reserves;
-  while (strcmp (rs->name, "video") != 0)
-    {
-      ++rs;
-      --nr;
-    }
-  if (nr)
-    __early_init_uefi_cons (cons, rs);
-  else
+  __cons_blit_init ();
+  if (! stage1->video || ! __early_init_uefi_cons (cons, stage1))
     __early_init_dummy_cons (cons);
-  cons->yc = CONS_ASSUME_CHAR_HEIGHT_PX;
-  cons->xc = CONS_ASSUME_CHAR_WIDTH_PX;
+  cons->active = true;
   __cons_full_reset (cons);
-  __cons_write (cons, "hello world\n", 12);
+}
+
+/**
+ * @internal
+ * Set up a background virtual console CONS, which shares the screen with
+ * the foreground console FG_CONS, but has its own grid & scrollback.
+ */
+static void
+__early_init_vt (struct cons *cons, const struct cons *fg_cons,
+		 const struct stage1 *stage1)
+{
+  *cons = *fg_cons;
+  cons->active = false;
+  memset (&cons->sb, 0, sizeof (cons->sb));
+  if (! __early_init_cells (cons, stage1))
+    __early_init_dummy_cons (cons);
+  else if (fg_cons->sb.buf)
+    __early_init_scrollback (cons, stage1);
+  __cons_full_reset (cons);
+}
+
+/**
+ * @internal
+ * Return the grid row number for line Y of the terminal.
+ */
+static size_t
+__cons_grid_row (const struct cons *cons, size_t y)
+{
+  size_t row = cons->top + y, yn = cons->yn;
+  if (row >= yn)
+    row -= yn;
+  return row;
+}
+
+static struct cons_cell *
+__cons_cell_at (struct cons *cons, size_t y, size_t x)
+{
+  return cons->cells + __cons_grid_row (cons, y) * cons->xn + x;
+}
+
+/**
+ * @internal
+ * Note that N character cells starting at (Y, X) in the grid have changed,
+ * & will need to be rendered to the canvas.
+ */
+static void
+__cons_dirty_cells (struct cons *cons, size_t y, size_t x, size_t n)
+{
+  __cons_mark_span (&cons->cells_dirty[__cons_grid_row (cons, y)],
+		    x, x + n);
+  cons->pending = true;
+}
+
+/**
+ * @internal
+ * Note that N character cells starting at (Y, X) have changed on the
+ * canvas, & will need to be copied to the frame buffer.
+ */
+static void
+__cons_dirty_canvas (struct cons *cons, size_t y, size_t x, size_t n)
+{
+  struct cons_span *span = cons->dirty;
+  if (! span)
+    return;
+  __cons_mark_span (span + y, x * cons->xc, (x + n) * cons->xc);
+  cons->pending = true;
+}
+
+/**
+ * @internal
+ * Remove the cells [X0, X1) from SPAN, if what is left is still a single
+ * span.  Otherwise leave SPAN alone.
+ */
+static void
+__cons_clip_span (struct cons_span *span, size_t x0, size_t x1)
+{
+  if (x0 <= span->x0 && x1 >= span->x1)
+    {
+      span->x0 = USHRT_MAX;
+      span->x1 = 0;
+    }
+  else if (x0 <= span->x0 && x1 > span->x0)
+    span->x0 = x1;
+  else if (x1 >= span->x1 && x0 < span->x1)
+    span->x1 = x0;
 }
 
 static void
 __cons_erase_line_cells (struct cons *cons, size_t y, size_t x, size_t n)
 {
-  cons->erase_line_cells (cons, y, x, n);
+  __cons_blank_cells (cons, __cons_cell_at (cons, y, x), n);
+  __cons_dirty_cells (cons, y, x, n);
 }
 
 static void
@@ -177,55 +533,232 @@ __cons_erase_lines (struct cons *cons, size_t y, size_t n)
     }
 }
 
+/**
+ * @internal
+ * Scroll the whole terminal up by N lines.  This only updates the grid; the
+ * canvas is brought up to date later by __cons_render (.).
+ */
 static void
-__cons_move_line_cells (struct cons *cons, size_t dst_y, size_t dst_x,
-					   size_t src_y, size_t src_x,
-					   size_t n)
+__cons_scroll (struct cons *cons, size_t n)
+{
+  size_t yn = cons->yn, top;
+  if (n > yn)
+    n = yn;
+  top = cons->top + n;
+  if (top >= yn)
+    top -= yn;
+  cons->top = top;
+  if (cons->scrolled + n < yn)
+    cons->scrolled += n;
+  else
+    cons->scrolled = yn;
+  cons->pending = true;
+  __cons_erase_lines (cons, yn - n, n);
+}
+
+/**
+ * @internal
+ * Return true if the canvas should show CONS's character cell grid, i.e.
+ * CONS is in the foreground & is not showing its scrollback buffer.
+ */
+static bool
+__cons_live (const struct cons *cons)
 {
-  cons->move_line_cells (cons, dst_y, dst_x, src_y, src_x, n);
+  return cons->active && ! cons->view;
 }
 
+/**
+ * @internal
+ * Bring the canvas up to date with the character cell grid.  Any scrolling
+ * since the last rendering is done with a single pass over the canvas,
+ * after which only the grid cells which have changed are redrawn.
+ */
 static void
-__cons_move_lines (struct cons *cons, size_t dst_y, size_t src_y, size_t n)
+__cons_render (struct cons *cons)
 {
-  size_t xn = cons->xn;
-  if (dst_y < src_y)
+  size_t yn = cons->yn, xn = cons->xn, scrolled = cons->scrolled, y;
+  if (! __cons_live (cons))
+    return;
+  if (scrolled)
     {
-      while (n-- != 0)
+      if (scrolled < yn)
 	{
-	  __cons_move_line_cells (cons, dst_y, 0, src_y, 0, xn);
-	  ++dst_y;
-	  ++src_y;
+	  cons->move_line_cells (cons, 0, 0, scrolled, 0, yn - scrolled, xn);
+	  for (y = 0; y < yn - scrolled; ++y)
+	    __cons_dirty_canvas (cons, y, 0, xn);
 	}
+      cons->scrolled = 0;
     }
-  else if (dst_y > src_y)
+  for (y = 0; y < yn; ++y)
+    {
+      size_t row = __cons_grid_row (cons, y), x, x1;
+      struct cons_span *span = &cons->cells_dirty[row];
+      const struct cons_cell *cell;
+      if (span->x0 >= span->x1)
+	continue;
+      x = span->x0;
+      x1 = span->x1;
+      cell = cons->cells + row * xn + x;
+      __cons_dirty_canvas (cons, y, x, x1 - x);
+      cons->draw_cells (cons, y, x, cell, x1 - x);
+      span->x0 = USHRT_MAX;
+      span->x1 = 0;
+    }
+}
+
+/**
+ * @internal
+ * Erase the rectangle of N cells in each of LINES lines starting at (Y, X).
+ * If the canvas is in step with the grid, erase the rectangle on the canvas
+ * too, in one go, so that it need not be rendered again.
+ */
+static void
+__cons_erase_rect (struct cons *cons, size_t y, size_t x,
+		   size_t lines, size_t n)
+{
+  size_t i;
+  if (! lines || ! n)
+    return;
+  for (i = 0; i < lines; ++i)
     {
-      dst_y += n;
-      src_y += n;
-      while (n-- != 0)
+      size_t row = __cons_grid_row (cons, y + i);
+      __cons_blank_cells (cons, cons->cells + row * cons->xn + x, n);
+      if (cons->scrolled || ! __cons_live (cons))
 	{
-	  --dst_y;
-	  --src_y;
-	  __cons_move_line_cells (cons, dst_y, 0, src_y, 0, xn);
+	  __cons_mark_span (&cons->cells_dirty[row], x, x + n);
+	  cons->pending = true;
+	}
+      else
+	{
+	  __cons_clip_span (&cons->cells_dirty[row], x, x + n);
+	  __cons_dirty_canvas (cons, y + i, x, n);
 	}
     }
+  if (! cons->scrolled && __cons_live (cons))
+    cons->erase_line_cells (cons, y, x, lines, n);
 }
 
+/**
+ * @internal
+ * Move the rectangle of N cells in each of LINES lines at (SY, SX) to
+ * (DY, DX), in the grid & on the canvas.  The rectangles may overlap.  If
+ * the canvas is not showing the grid, only update the grid.
+ */
 static void
-__cons_scroll (struct cons *cons, size_t n)
+__cons_move_rect (struct cons *cons, size_t dy, size_t dx,
+		  size_t sy, size_t sx, size_t lines, size_t n)
 {
-  __cons_move_lines (cons, n, 0, cons->yn - n);
-  __cons_erase_lines (cons, cons->yn - n, n);
+  bool live = __cons_live (cons);
+  size_t i;
+  if (! lines || ! n)
+    return;
+  if (live)
+    __cons_render (cons);
+  for (i = 0; i < lines; ++i)
+    {
+      size_t j = dy <= sy ? i : lines - 1 - i;
+      memmove (__cons_cell_at (cons, dy + j, dx),
+	       __cons_cell_at (cons, sy + j, sx),
+	       n * sizeof (struct cons_cell));
+      if (live)
+	__cons_dirty_canvas (cons, dy + j, dx, n);
+    }
+  if (live)
+    cons->move_line_cells (cons, dy, dx, sy, sx, lines, n);
+}
+
+/**
+ * @internal
+ * Save the top N lines of the terminal in the scrollback buffer, before
+ * they scroll away.  If the terminal is showing the scrollback buffer, keep
+ * the view on the same lines.
+ */
+static void
+__cons_save_lines (struct cons *cons, size_t n)
+{
+  struct cons_scrollback *sb = &cons->sb;
+  size_t y;
+  if (! sb->buf)
+    return;
+  for (y = 0; y < n; ++y)
+    __cons_scrollback_push (sb, __cons_cell_at (cons, y, 0));
+  if (cons->view)
+    {
+      cons->view += n;
+      if (cons->view > sb->lines)
+	cons->view = sb->lines;
+    }
+}
+
+/**
+ * @internal
+ * Scroll lines TOP, ..., BOT - 1 of the terminal up by N lines.  If SAVE is
+ * true, & TOP is the top of the screen, keep the lines which scroll off in
+ * the scrollback buffer; this is for true scrolling, not for deleting
+ * lines.
+ */
+static void
+__cons_scroll_up (struct cons *cons, size_t top, size_t bot, size_t n,
+		  bool save)
+{
+  size_t xn = cons->xn;
+  if (n > bot - top)
+    n = bot - top;
+  if (save && top == 0)
+    __cons_save_lines (cons, n);
+  if (top == 0 && bot == cons->yn)
+    {
+      __cons_scroll (cons, n);
+      return;
+    }
+  __cons_move_rect (cons, top, 0, top + n, 0, bot - top - n, xn);
+  __cons_erase_rect (cons, bot - n, 0, n, xn);
+}
+
+/**
+ * @internal
+ * Scroll lines TOP, ..., BOT - 1 of the terminal down by N lines.
+ */
+static void
+__cons_scroll_down (struct cons *cons, size_t top, size_t bot, size_t n)
+{
+  size_t xn = cons->xn;
+  if (n > bot - top)
+    n = bot - top;
+  __cons_move_rect (cons, top + n, 0, top, 0, bot - top - n, xn);
+  __cons_erase_rect (cons, top, 0, n, xn);
 }
 
 static void
 __cons_index (struct cons *cons)
 {
   size_t y = cons->y;
-  if (y < cons->yn - 1)
+  if (y == cons->scroll_bot - 1U)
+    __cons_scroll_up (cons, cons->scroll_top, cons->scroll_bot, 1, true);
+  else if (y < cons->yn - 1U)
     cons->y = y + 1;
-  else
-    __cons_scroll (cons, 1);
+}
+
+static void
+__cons_reverse_index (struct cons *cons)
+{
+  size_t y = cons->y;
+  if (y == cons->scroll_top)
+    __cons_scroll_down (cons, cons->scroll_top, cons->scroll_bot, 1);
+  else if (y != 0)
+    cons->y = y - 1;
+}
+
+static void
+__cons_move_to (struct cons *cons, size_t y, size_t x)
+{
+  if (y >= cons->yn)
+    y = cons->yn - 1;
+  if (x >= cons->xn)
+    x = cons->xn - 1;
+  cons->y = y;
+  cons->x = x;
+  cons->red_zone = false;
 }
 
 static void
@@ -247,9 +780,20 @@ __cons_cntrl (struct cons *cons, unsigned char c)
 {
   switch (c)
     {
+    case '\b':
+      if (cons->x != 0 && ! cons->red_zone)
+	--cons->x;
+      cons->red_zone = false;
+      break;
+    case '\t':
+      __cons_move_to (cons, cons->y, (cons->x | 7U) + 1);
+      break;
     case '\n':
       __cons_newline (cons);
       break;
+    case '\r':
+      __cons_move_to (cons, cons->y, 0);
+      break;
     case 0x1b:
       cons->state = TTY_ESC;
       break;
@@ -259,12 +803,17 @@ __cons_cntrl (struct cons *cons, unsigned char c)
 static void
 __cons_write_glyph (struct cons *cons, wchar_t wc, unsigned width)
 {
+  struct cons_cell *cell;
   unsigned short x;
   if (! width)
     return;
   if (cons->red_zone || cons->x + width > cons->xn)
     __cons_advance (cons);
-  cons->draw_char (cons, cons->y, cons->x, wc);
+  cell = __cons_cell_at (cons, cons->y, cons->x);
+  cell->ch = wc;
+  cell->fg = cons->fg;
+  cell->bg = cons->bg;
+  __cons_dirty_cells (cons, cons->y, cons->x, width);
   x = cons->x += width;
   if (x >= cons->xn)
     {
@@ -273,6 +822,49 @@ __cons_write_glyph (struct cons *cons, wchar_t wc, unsigned width)
     }
 }
 
+/**
+ * @internal
+ * Write a run of N printable ASCII characters at P, filling whole line
+ * segments of the grid at a time.  This should give the same result as
+ * calling __cons_write_glyph (.) for each character.
+ */
+static void
+__cons_write_ascii (struct cons *cons, const unsigned char *p, size_t n)
+{
+  size_t xn = cons->xn;
+  cons_std_color_t fg = cons->fg, bg = cons->bg;
+  while (n != 0)
+    {
+      size_t x, seg, i;
+      struct cons_cell *cell;
+      if (cons->red_zone)
+	__cons_advance (cons);
+      x = cons->x;
+      seg = xn - x;
+      if (seg > n)
+	seg = n;
+      cell = __cons_cell_at (cons, cons->y, x);
+      for (i = 0; i < seg; ++i)
+	{
+	  cell->ch = p[i];
+	  cell->fg = fg;
+	  cell->bg = bg;
+	  ++cell;
+	}
+      __cons_dirty_cells (cons, cons->y, x, seg);
+      p += seg;
+      n -= seg;
+      x += seg;
+      if (x >= xn)
+	{
+	  cons->x = xn - 1;
+	  cons->red_zone = true;
+	}
+      else
+	cons->x = x;
+    }
+}
+
 static void
 __cons_write_bad_glyph (struct cons *cons)
 {
@@ -377,6 +969,28 @@ __cons_putch_esc (struct cons *cons, unsigned char c)
   cons->state = TTY_NORM;
   switch (c)
     {
+    case '[':
+      cons->state = TTY_CSI;
+      cons->csi_nparams = 0;
+      cons->csi_ignore = false;
+      memset (cons->csi_params, 0, sizeof (cons->csi_params));
+      break;
+    case '7':
+      cons->saved_y = cons->y;
+      cons->saved_x = cons->x;
+      break;
+    case '8':
+      __cons_move_to (cons, cons->saved_y, cons->saved_x);
+      break;
+    case 'D':
+      __cons_index (cons);
+      break;
+    case 'E':
+      __cons_newline (cons);
+      break;
+    case 'M':
+      __cons_reverse_index (cons);
+      break;
     case 'c':
       __cons_full_reset (cons);
       break;
@@ -385,19 +999,552 @@ __cons_putch_esc (struct cons *cons, unsigned char c)
     }
 }
 
+/**
+ * @internal
+ * Return control sequence parameter number I, or DFLT if the parameter is
+ * absent or zero.
+ */
+static size_t
+__cons_csi_param (const struct cons *cons, size_t i, size_t dflt)
+{
+  if (i > cons->csi_nparams || i >= CONS_CSI_MAX_PARAMS
+      || ! cons->csi_params[i])
+    return dflt;
+  return cons->csi_params[i];
+}
+
+static size_t
+__cons_csi_nparams (const struct cons *cons)
+{
+  size_t n = cons->csi_nparams + 1U;
+  return n < CONS_CSI_MAX_PARAMS ? n : CONS_CSI_MAX_PARAMS;
+}
+
+static void
+__cons_set_fg (struct cons *cons, cons_std_color_t color)
+{
+  if (cons->reverse)
+    cons->bg = color;
+  else
+    cons->fg = color;
+}
+
+static void
+__cons_set_bg (struct cons *cons, cons_std_color_t color)
+{
+  if (cons->reverse)
+    cons->fg = color;
+  else
+    cons->bg = color;
+}
+
+static void
+__cons_set_reverse (struct cons *cons, bool reverse)
+{
+  if (cons->reverse != reverse)
+    {
+      cons_std_color_t fg = cons->fg;
+      cons->fg = cons->bg;
+      cons->bg = fg;
+      cons->reverse = reverse;
+    }
+}
+
+static void
+__cons_set_bold (struct cons *cons, bool bold)
+{
+  cons->bold = bold;
+  if (cons->fg_ansi < 8)
+    __cons_set_fg (cons, __cons_ansi_colors[cons->fg_ansi + 8 * bold]);
+}
+
+/**
+ * @internal
+ * Return the color for xterm's 256-color palette entry NUM: the 16 basic
+ * colors, then a 6 * 6 * 6 color cube, then 24 shades of grey.
+ */
+static cons_std_color_t
+__cons_color_256 (size_t num)
+{
+  static const uint8_t level[6] = { 0x00, 0x5f, 0x87, 0xaf, 0xd7, 0xff };
+  cons_std_color_t color;
+  if (num < 16)
+    return __cons_ansi_colors[num];
+  color.bgr.x = 0xff;
+  if (num < 232)
+    {
+      num -= 16;
+      color.bgr.r = level[num / 36];
+      color.bgr.g = level[num / 6 % 6];
+      color.bgr.b = level[num % 6];
+    }
+  else
+    color.bgr.r = color.bgr.g = color.bgr.b = 8 + (num - 232) * 10;
+  return color;
+}
+
+/**
+ * @internal
+ * Parse an extended color specification, 5;NUM or 2;R;G;B, starting at
+ * control sequence parameter I.  Return the number of parameters used, or
+ * 0 if the specification is bad.
+ */
+static size_t
+__cons_sgr_color (const struct cons *cons, size_t i, cons_std_color_t *color)
+{
+  size_t n = __cons_csi_nparams (cons);
+  const unsigned short *par = cons->csi_params;
+  if (i + 1 < n && par[i] == 5 && par[i + 1] <= UINT8_MAX)
+    {
+      *color = __cons_color_256 (par[i + 1]);
+      return 2;
+    }
+  if (i + 3 < n && par[i] == 2 && par[i + 1] <= UINT8_MAX
+      && par[i + 2] <= UINT8_MAX && par[i + 3] <= UINT8_MAX)
+    {
+      color->bgr.r = par[i + 1];
+      color->bgr.g = par[i + 2];
+      color->bgr.b = par[i + 3];
+      color->bgr.x = 0xff;
+      return 4;
+    }
+  return 0;
+}
+
+/** @internal Handle SGR, CSI ... m, which sets character attributes. */
+static void
+__cons_sgr (struct cons *cons)
+{
+  size_t n = __cons_csi_nparams (cons), i, used;
+  cons_std_color_t color;
+  for (i = 0; i < n; ++i)
+    {
+      unsigned short par = cons->csi_params[i];
+      switch (par)
+	{
+	case 0:
+	  __cons_reset_attrs (cons);
+	  break;
+	case 1:
+	  __cons_set_bold (cons, true);
+	  break;
+	case 22:
+	  __cons_set_bold (cons, false);
+	  break;
+	case 7:
+	  __cons_set_reverse (cons, true);
+	  break;
+	case 27:
+	  __cons_set_reverse (cons, false);
+	  break;
+	case 30:  case 31:  case 32:  case 33:
+	case 34:  case 35:  case 36:  case 37:
+	  cons->fg_ansi = par - 30;
+	  __cons_set_bold (cons, cons->bold);
+	  break;
+	case 39:
+	  cons->fg_ansi = 7;
+	  __cons_set_bold (cons, cons->bold);
+	  break;
+	case 90:  case 91:  case 92:  case 93:
+	case 94:  case 95:  case 96:  case 97:
+	  cons->fg_ansi = UINT8_MAX;
+	  __cons_set_fg (cons, __cons_ansi_colors[par - 90 + 8]);
+	  break;
+	case 40:  case 41:  case 42:  case 43:
+	case 44:  case 45:  case 46:  case 47:
+	  __cons_set_bg (cons, __cons_ansi_colors[par - 40]);
+	  break;
+	case 49:
+	  __cons_set_bg (cons, CONS_DEFAULT_BG);
+	  break;
+	case 100:  case 101:  case 102:  case 103:
+	case 104:  case 105:  case 106:  case 107:
+	  __cons_set_bg (cons, __cons_ansi_colors[par - 100 + 8]);
+	  break;
+	case 38:
+	case 48:
+	  used = __cons_sgr_color (cons, i + 1, &color);
+	  if (! used)
+	    i = n;
+	  else
+	    {
+	      if (par == 38)
+		{
+		  cons->fg_ansi = UINT8_MAX;
+		  __cons_set_fg (cons, color);
+		}
+	      else
+		__cons_set_bg (cons, color);
+	      i += used;
+	    }
+	  break;
+	default:
+	  ;
+	}
+    }
+  __cons_update_colors (cons);
+}
+
+/** @internal Handle ED, CSI ... J, which erases in the display. */
+static void
+__cons_erase_in_display (struct cons *cons)
+{
+  size_t yn = cons->yn, xn = cons->xn, y = cons->y, x = cons->x;
+  switch (__cons_csi_param (cons, 0, 0))
+    {
+    case 0:
+      __cons_erase_rect (cons, y, x, 1, xn - x);
+      __cons_erase_rect (cons, y + 1, 0, yn - y - 1, xn);
+      break;
+    case 1:
+      __cons_erase_rect (cons, 0, 0, y, xn);
+      __cons_erase_rect (cons, y, 0, 1, x + 1);
+      break;
+    case 2:
+    case 3:
+      __cons_erase_rect (cons, 0, 0, yn, xn);
+      break;
+    default:
+      ;
+    }
+}
+
+/** @internal Handle EL, CSI ... K, which erases in the cursor line. */
+static void
+__cons_erase_in_line (struct cons *cons)
+{
+  size_t xn = cons->xn, y = cons->y, x = cons->x;
+  switch (__cons_csi_param (cons, 0, 0))
+    {
+    case 0:
+      __cons_erase_rect (cons, y, x, 1, xn - x);
+      break;
+    case 1:
+      __cons_erase_rect (cons, y, 0, 1, x + 1);
+      break;
+    case 2:
+      __cons_erase_rect (cons, y, 0, 1, xn);
+      break;
+    default:
+      ;
+    }
+}
+
+/**
+ * @internal
+ * Handle a complete control sequence CSI ... C, where C is the final byte.
+ */
+static void
+__cons_csi (struct cons *cons, unsigned char c)
+{
+  size_t y = cons->y, x = cons->x, xn = cons->xn,
+	 top = cons->scroll_top, bot = cons->scroll_bot,
+	 n = __cons_csi_param (cons, 0, 1);
+  switch (c)
+    {
+    case 'A':
+      top = y >= top ? top : 0;
+      __cons_move_to (cons, y - top > n ? y - n : top, x);
+      break;
+    case 'B':
+      bot = y < bot ? bot : cons->yn;
+      __cons_move_to (cons, bot - 1 - y > n ? y + n : bot - 1, x);
+      break;
+    case 'C':
+      __cons_move_to (cons, y, x + n);
+      break;
+    case 'D':
+      __cons_move_to (cons, y, x > n ? x - n : 0);
+      break;
+    case 'E':
+      __cons_move_to (cons, y + n, 0);
+      break;
+    case 'F':
+      __cons_move_to (cons, y > n ? y - n : 0, 0);
+      break;
+    case 'G':
+    case '`':
+      __cons_move_to (cons, y, n - 1);
+      break;
+    case 'd':
+      __cons_move_to (cons, n - 1, x);
+      break;
+    case 'H':
+    case 'f':
+      __cons_move_to (cons, n - 1, __cons_csi_param (cons, 1, 1) - 1);
+      break;
+    case 'J':
+      __cons_erase_in_display (cons);
+      break;
+    case 'K':
+      __cons_erase_in_line (cons);
+      break;
+    case 'L':
+      if (y >= top && y < bot)
+	{
+	  __cons_scroll_down (cons, y, bot, n);
+	  __cons_move_to (cons, y, 0);
+	}
+      break;
+    case 'M':
+      if (y >= top && y < bot)
+	{
+	  __cons_scroll_up (cons, y, bot, n, false);
+	  __cons_move_to (cons, y, 0);
+	}
+      break;
+    case '@':
+      if (n > xn - x)
+	n = xn - x;
+      __cons_move_rect (cons, y, x + n, y, x, 1, xn - x - n);
+      __cons_erase_rect (cons, y, x, 1, n);
+      break;
+    case 'P':
+      if (n > xn - x)
+	n = xn - x;
+      __cons_move_rect (cons, y, x, y, x + n, 1, xn - x - n);
+      __cons_erase_rect (cons, y, xn - n, 1, n);
+      break;
+    case 'X':
+      __cons_erase_rect (cons, y, x, 1, n < xn - x ? n : xn - x);
+      break;
+    case 'S':
+      __cons_scroll_up (cons, top, bot, n, true);
+      break;
+    case 'T':
+      __cons_scroll_down (cons, top, bot, n);
+      break;
+    case 'm':
+      __cons_sgr (cons);
+      break;
+    case 'r':
+      top = __cons_csi_param (cons, 0, 1);
+      bot = __cons_csi_param (cons, 1, cons->yn);
+      if (bot > cons->yn)
+	bot = cons->yn;
+      if (top < bot)
+	{
+	  cons->scroll_top = top - 1;
+	  cons->scroll_bot = bot;
+	  __cons_move_to (cons, 0, 0);
+	}
+      break;
+    case 's':
+      cons->saved_y = y;
+      cons->saved_x = x;
+      break;
+    case 'u':
+      __cons_move_to (cons, cons->saved_y, cons->saved_x);
+      break;
+    default:
+      ;
+    }
+}
+
+static void
+__cons_putch_csi (struct cons *cons, unsigned char c)
+{
+  if (c >= '0' && c <= '9')
+    {
+      if (cons->csi_nparams < CONS_CSI_MAX_PARAMS)
+	{
+	  unsigned short *par = &cons->csi_params[cons->csi_nparams];
+	  if (*par < 1000)
+	    *par = *par * 10 + (c - '0');
+	}
+    }
+  else if (c == ';')
+    {
+      if (cons->csi_nparams < CONS_CSI_MAX_PARAMS)
+	++cons->csi_nparams;
+    }
+  else if (c >= 0x20 && c <= 0x3f)
+    /* Intermediate bytes, or private parameter strings. */
+    cons->csi_ignore = true;
+  else if (c >= 0x40 && c <= 0x7e)
+    {
+      cons->state = TTY_NORM;
+      if (! cons->csi_ignore)
+	__cons_csi (cons, c);
+    }
+  else if (c == 0x18 || c == 0x1a)
+    cons->state = TTY_NORM;
+  else if (__cons_iscntrl (c))
+    __cons_cntrl (cons, c);
+}
+
 void
 __early_init_cons (const struct stage1 *stage1)
 {
-  __early_init_cons_1 (&__console, stage1);
+  unsigned vt;
+  __early_init_cons_1 (&__consoles[0], stage1);
+  for (vt = 1; vt < CONS_VTS; ++vt)
+    __early_init_vt (&__consoles[vt], &__consoles[0], stage1);
+  __cons_set_flush_rate (CONS_FLUSH_HZ);
+  __cons_write (&__console, "hello world\n", 12);
 }
 
+/**
+ * @internal
+ * Return the number of printable ASCII characters, 0x20--0x7e, at the
+ * start of the N bytes at P.
+ */
+static size_t
+__cons_ascii_run (const unsigned char *p, size_t n)
+{
+  size_t run = 0;
+#if defined __amd64__ && defined __GNUC__
+  /*
+   * Adding 0x60 maps 0x20--0x7e to -0x80--(-0x22) as signed bytes, & all
+   * other byte values to -0x21 or above.
+   */
+  const __m128i bias = _mm_set1_epi8 (0x60), limit = _mm_set1_epi8 (-0x21);
+  while (n - run >= sizeof (__m128i))
+    {
+      __m128i v = _mm_loadu_si128 ((const __m128i *) (p + run));
+      unsigned mask = (unsigned) _mm_movemask_epi8
+			(_mm_cmplt_epi8 (_mm_add_epi8 (v, bias), limit));
+      if (mask != 0xffff)
+	return run + __builtin_ctz (~mask);
+      run += sizeof (__m128i);
+    }
+#endif
+  while (run < n && p[run] >= 0x20 && p[run] <= 0x7e)
+    ++run;
+  return run;
+}
+
+/**
+ * Render any changes in the console's character cell grid to the canvas,
+ * & copy any changed parts of the canvas to the video frame buffer.
+ */
 void
-__cons_write (struct cons *cons, const void *data, size_t n)
+__cons_flush (struct cons *cons)
+{
+  struct cons_span *span = cons->dirty;
+  size_t cpp, yc, xs, xsfb, y, yn;
+  uint64_t bytes = 0;
+  if (! cons->active)
+    return;
+  __cons_render (cons);
+  cons->pending = false;
+  if (! span)
+    return;
+  cpp = __cons_bytes_per_pixel (cons->type);
+  yc = cons->yc;
+  xs = cons->xs;
+  xsfb = cons->xsfb;
+  yn = cons->yn;
+  for (y = 0; y < yn; ++y, ++span)
+    {
+      unsigned short x0 = span->x0, x1 = span->x1;
+      size_t len, py;
+      const char *src;
+      char *dest;
+      if (x0 >= x1)
+	continue;
+      len = (x1 - x0) * cpp;
+      src = cons->canvas + y * yc * xs + x0 * cpp;
+      dest = cons->fb + y * yc * xsfb + x0 * cpp;
+      for (py = 0; py < yc; ++py)
+	{
+	  __cons_copy_row (dest, src, len, true);
+	  src += xs;
+	  dest += xsfb;
+	}
+      bytes += len * yc;
+      span->x0 = USHRT_MAX;
+      span->x1 = 0;
+    }
+  if (bytes)
+    {
+      ++__cons_flush_stats.flushes;
+      __cons_flush_stats.bytes += bytes;
+    }
+}
+
+/**
+ * Set the maximum number of times per second which __cons_flush_sched (.)
+ * will update the frame buffer.  If HZ is 0, or the TSC frequency is
+ * unknown, flush on every request.
+ */
+void
+__cons_set_flush_rate (unsigned hz)
+{
+  __cons_sched.hz = hz;
+  __cons_sched.interval = hz ? __tsc_hz / hz : 0;
+}
+
+unsigned
+__cons_get_flush_rate (void)
+{
+  return __cons_sched.interval ? __cons_sched.hz : 0;
+}
+
+/**
+ * Ask to show the console's output, if there is any new output.  If the
+ * frame buffer was updated too recently, do nothing for now; the caller
+ * should ask again later, e.g. from the idle loop, so that the output is
+ * eventually shown.
+ */
+void
+__cons_flush_sched (struct cons *cons)
+{
+  uint64_t now;
+  if (! cons->active || ! cons->pending)
+    return;
+  if (__cons_sched.interval)
+    {
+      now = __read_tsc ();
+      if (now - __cons_sched.last < __cons_sched.interval)
+	{
+	  ++__cons_flush_stats.deferred;
+	  return;
+	}
+      __cons_sched.last = now;
+    }
+  __cons_flush (cons);
+}
+
+/**
+ * Show the foreground console's output right away, whatever the flush
+ * rate.  This is for use when the system is about to stop.
+ */
+void
+__cons_flush_panic (void)
+{
+  unsigned vt;
+  for (vt = 0; vt < CONS_VTS; ++vt)
+    if (__consoles[vt].active)
+      __cons_flush (&__consoles[vt]);
+  __cons_sched.last = __read_tsc ();
+}
+
+/**
+ * Process N bytes of teletype output at DATA, updating the console's
+ * character cell grid, but do not render the output yet.
+ */
+void
+__cons_put (struct cons *cons, const void *data, size_t n)
 {
   const unsigned char *p = data;
-  while (n-- != 0)
+  while (n != 0)
     {
-      unsigned char c = *p++;
+      unsigned char c;
+      if (cons->state == TTY_NORM)
+	{
+	  size_t run = __cons_ascii_run (p, n);
+	  if (run)
+	    {
+	      __cons_write_ascii (cons, p, run);
+	      p += run;
+	      n -= run;
+	      continue;
+	    }
+	}
+      c = *p++;
+      --n;
       switch (cons->state)
 	{
 	default:
@@ -412,6 +1559,107 @@ __cons_write (struct cons *cons, const void *data, size_t n)
 	  break;
 	case TTY_ESC:
 	  __cons_putch_esc (cons, c);
+	  break;
+	case TTY_CSI:
+	  __cons_putch_csi (cons, c);
 	}
     }
 }
+
+/**
+ * @internal
+ * Draw the scrollback buffer & the top of the grid, as seen when the view is
+ * scrolled back by cons->view lines.
+ */
+static void
+__cons_render_view (struct cons *cons)
+{
+  struct cons_scrollback *sb = &cons->sb;
+  size_t yn = cons->yn, xn = cons->xn, view = cons->view, y, pos;
+  pos = __cons_scrollback_find (sb, view);
+  for (y = 0; y < yn; ++y)
+    {
+      const struct cons_cell *cell;
+      if (y < view)
+	{
+	  pos = __cons_scrollback_get (sb, pos, sb->line);
+	  cell = sb->line;
+	}
+      else
+	cell = __cons_cell_at (cons, y - view, 0);
+      cons->draw_cells (cons, y, 0, cell, xn);
+      __cons_dirty_canvas (cons, y, 0, xn);
+    }
+}
+
+/**
+ * @internal
+ * Redraw the whole screen for the foreground console CONS.
+ */
+static void
+__cons_redraw (struct cons *cons)
+{
+  size_t y, yn = cons->yn;
+  if (cons->view)
+    __cons_render_view (cons);
+  else
+    {
+      cons->scrolled = 0;
+      for (y = 0; y < yn; ++y)
+	__cons_dirty_cells (cons, y, 0, cons->xn);
+    }
+  __cons_flush (cons);
+}
+
+/**
+ * Scroll the view of the console back by BACK lines into the scrollback
+ * buffer, or return to the live terminal if BACK is 0, & show the result
+ * if the console is in the foreground.
+ * Output to the console still goes to its character cell grid meanwhile.
+ * Return the number of lines by which the view is actually scrolled back.
+ */
+size_t
+__cons_view (struct cons *cons, size_t back)
+{
+  if (back > cons->sb.lines)
+    back = cons->sb.lines;
+  if (back == cons->view)
+    return back;
+  cons->view = back;
+  if (cons->active)
+    __cons_redraw (cons);
+  return back;
+}
+
+/**
+ * Bring virtual console number VT to the foreground, & redraw the screen
+ * from its character cell grid.  Output to background consoles only
+ * updates their grids.  Return false if VT is not a valid console number.
+ */
+bool
+__cons_switch (unsigned vt)
+{
+  struct cons *cons;
+  unsigned i;
+  if (vt >= CONS_VTS)
+    return false;
+  cons = &__consoles[vt];
+  if (cons->active)
+    return true;
+  for (i = 0; i < CONS_VTS; ++i)
+    __consoles[i].active = false;
+  cons->active = true;
+  __cons_redraw (cons);
+  return true;
+}
+
+/**
+ * Process N bytes of teletype output at DATA, & show the result, subject to
+ * the flush rate limit.
+ */
+void
+__cons_write (struct cons *cons, const void *data, size_t n)
+{
+  __cons_put (cons, data, n);
+  __cons_flush_sched (cons);
+}
@@ -51,6 +51,16 @@ enum
   UNICODE_BAD = L'\xfffd'
 };
 
+/**
+ * @internal
+ * Maximum number of parameters we keep for a control sequence; any further
+ * parameters are ignored.
+ */
+enum
+{
+  CONS_CSI_MAX_PARAMS = 16
+};
+
 typedef union
   {
     uint32_t w;
@@ -80,6 +90,100 @@ typedef union
     uint16_t w;
   } cons_bgr555_color_t;
 
+/**
+ * @internal
+ * Horizontal span, [x0, x1), within one row of character cells.  Depending
+ * on context, this is measured in either pixels or character cells.  The
+ * span is empty if x0 >= x1.
+ */
+struct cons_span
+{
+  unsigned short x0, x1;
+};
+
+/** Contents of one character cell on the terminal. */
+struct cons_cell
+{
+  wchar_t ch;
+  cons_std_color_t fg, bg;
+};
+
+/**
+ * Virtual consoles.  Each has its own character cell grid, scrollback
+ * buffer, & teletype state, but only the one in the foreground draws to the
+ * screen.
+ */
+enum
+{
+  CONS_VT_KLOG,		/* kernel log */
+  CONS_VT_BIOS,		/* emulated BIOS text screen */
+  CONS_VT_DEBUG,	/* debug shell */
+  CONS_VTS
+};
+
+/**
+ * @internal
+ * Largest factor by which the console may scale up its glyphs on large
+ * screens.
+ */
+enum
+{
+  CONS_MAX_SCALE = 4
+};
+
+/**
+ * @internal
+ * Default maximum number of times per second to copy console output to the
+ * video frame buffer.
+ */
+#ifndef CONS_FLUSH_HZ
+# define CONS_FLUSH_HZ		60
+#endif
+
+/** Statistics on console output flushed to the video frame buffer. */
+struct cons_flush_stats
+{
+  /** Number of flushes which copied anything to the frame buffer. */
+  uint64_t flushes;
+  /**
+   * Number of times there was output to show, but the flush was put off
+   * because the last one was too recent.
+   */
+  uint64_t deferred;
+  /** Number of bytes copied to the frame buffer. */
+  uint64_t bytes;
+};
+
+/**
+ * @internal
+ * Default number of bytes to set aside for each console's scrollback
+ * buffer.
+ */
+#ifndef CONS_SCROLLBACK_SIZE
+# define CONS_SCROLLBACK_SIZE	0x40000
+#endif
+
+/**
+ * @internal
+ * Store of lines which have scrolled off the top of the terminal.  Each line
+ * is kept as a run-length-encoded record in a ring of bytes; when the ring
+ * is full, the oldest lines are thrown away.
+ */
+struct cons_scrollback
+{
+  /** Ring of line records, or NULL if there is no scrollback buffer. */
+  unsigned char *buf;
+  /** Size of the ring, offset of the oldest record, & bytes in use. */
+  size_t size, head, used;
+  /** Number of lines in the ring. */
+  size_t lines;
+  /** Number of character cells per line. */
+  size_t xn;
+  /** Space for one decoded line, & scratch space for encoding a line. */
+  struct cons_cell *line;
+  unsigned char *scratch;
+};
+
 struct cons
 {
   /**
@@ -111,13 +215,51 @@ struct cons
   wchar_t e8;
   /** Current foreground and background colors. */
   cons_std_color_t fg, bg;
+  /**
+   * Current foreground & background colors, mapped to the frame buffer's
+   * pixel format.  These are updated whenever fg & bg change.
+   */
+  uint32_t fg_px, bg_px;
   /** Height and width of each character in pixels. */
   uint8_t yc, xc;
+  /**
+   * Factor by which glyphs are scaled up, so that yc & xc are this many
+   * times CONS_ASSUME_CHAR_HEIGHT_PX & CONS_ASSUME_CHAR_WIDTH_PX.
+   */
+  uint8_t scale;
   /**
    * Whether we are "off" the end of the screen & should scroll the screen
    * before printing another character.
    */
   unsigned red_zone : 1;
+  /**
+   * Whether this console is in the foreground, & owns the canvas & the
+   * frame buffer.
+   */
+  unsigned active : 1;
+  /** Whether bold (bright) foreground & reverse video are in effect. */
+  unsigned bold : 1, reverse : 1;
+  /**
+   * Whether the control sequence being parsed is one we do not handle,
+   * e.g. because it has a private parameter string or intermediate bytes.
+   */
+  unsigned csi_ignore : 1;
+  /**
+   * ANSI color number (0--7) of the current foreground color, or UINT8_MAX
+   * if the color was not set that way.  This is for bold to work.
+   */
+  uint8_t fg_ansi;
+  /** Number of control sequence parameters seen so far, less 1. */
+  uint8_t csi_nparams;
+  /** Parameters of the control sequence being parsed. */
+  unsigned short csi_params[CONS_CSI_MAX_PARAMS];
+  /**
+   * Scrolling region: lines scroll_top, ..., scroll_bot - 1.  Line feeds
+   * on the last line of the region scroll only the region.
+   */
+  unsigned short scroll_top, scroll_bot;
+  /** Cursor position saved by ESC 7 or CSI s. */
+  unsigned short saved_y, saved_x;
   /** Actual video frame buffer as provided by the video card. */
   char *fb;
   /**
@@ -130,15 +272,62 @@ struct cons
    * different from the frame buffer's.
    */
   char *canvas;
+  /**
+   * For each row of character cells, the span of pixels in the canvas
+   * which have changed since the canvas was last copied to the frame
+   * buffer.  This has yn entries.
+   */
+  struct cons_span *dirty;
+  /**
+   * Character cell grid, giving what the terminal should look like.  This
+   * holds yn rows of xn cells each.  The rows form a ring: the top line of
+   * the terminal is at row number top in the grid, the next line is at row
+   * top + 1 (modulo yn), & so on.  Scrolling the whole terminal is simply
+   * a matter of advancing top.
+   */
+  struct cons_cell *cells;
+  /**
+   * For each row in the grid, the span of cells which have changed since
+   * they were last rendered to the canvas.  This has yn entries, indexed by
+   * grid row number rather than line number.
+   */
+  struct cons_span *cells_dirty;
+  /** Grid row number for the top line of the terminal. */
+  unsigned short top;
+  /**
+   * Number of lines by which the terminal has scrolled up since the grid
+   * was last rendered to the canvas.
+   */
+  unsigned short scrolled;
+  /**
+   * Whether the grid or the canvas has changed since the last flush, so
+   * that there is something for __cons_flush (.) to do.
+   */
+  bool pending;
+  /** Scrollback buffer. */
+  struct cons_scrollback sb;
+  /**
+   * Number of lines by which the view is scrolled back into the scrollback
+   * buffer, or 0 if the terminal is showing the live grid.
+   */
+  size_t view;
   /** Pointers to actual implementations of character drawing operations. */
-  void (*draw_char) (struct cons *, size_t, size_t, wchar_t);
-  void (*erase_line_cells) (struct cons *, size_t, size_t, size_t);
+  uint32_t (*map_color) (cons_std_color_t);
+  void (*draw_char) (struct cons *, size_t, size_t,
+		     const struct cons_cell *);
+  void (*draw_cells) (struct cons *, size_t, size_t,
+		      const struct cons_cell *, size_t);
+  void (*erase_line_cells) (struct cons *, size_t, size_t, size_t, size_t);
   void (*move_line_cells) (struct cons *, size_t, size_t, size_t, size_t,
-					  size_t);
+					  size_t, size_t);
 };
 
-extern const uint8_t __cons_font_default_direct[95][13];
-extern struct cons __console;
+extern const uint8_t __cons_font_default_glyphs[][13];
+extern const uint16_t __cons_font_default_pages[][256];
+extern const uint8_t __cons_font_default_page_dir[0x1100];
+extern struct cons __consoles[CONS_VTS];
+/** The kernel log console. */
+#define __console	(__consoles[CONS_VT_KLOG])
 
 #define __ARRAYLEN(__a) \
 	(sizeof (__a) / sizeof ((__a)[0]) \
@@ -150,7 +339,7 @@ extern struct cons __console;
  */
 enum
 {
-  CONS_ASSUME_CHAR_HEIGHT_PX = __ARRAYLEN (__cons_font_default_direct[0])
+  CONS_ASSUME_CHAR_HEIGHT_PX = __ARRAYLEN (__cons_font_default_glyphs[0])
 };
 /**
  * @internal
@@ -159,7 +348,7 @@ enum
 enum
 {
   CONS_ASSUME_CHAR_WIDTH_PX
-    = sizeof (__cons_font_default_direct[0][0]) * CHAR_BIT
+    = sizeof (__cons_font_default_glyphs[0][0]) * CHAR_BIT
 };
 /**
  * @internal
@@ -213,16 +402,73 @@ __get1b (uint8_t *__accum, const uint8_t **__stream)
   return __c;
 }
 
+extern void __cons_put (struct cons *, const void *, size_t);
 extern void __cons_write (struct cons *, const void *, size_t);
-extern void __cons_klog_16_draw_char (struct cons *, size_t, size_t, wchar_t);
-extern void __cons_klog_16_erase_line_cells (struct cons *, size_t, size_t,
-							    size_t);
-extern void __cons_klog_16_move_line_cells (struct cons *, size_t, size_t,
-					    size_t, size_t, size_t);
-extern void __cons_klog_32_draw_char (struct cons *, size_t, size_t, wchar_t);
-extern void __cons_klog_32_erase_line_cells (struct cons *, size_t, size_t,
-							    size_t);
-extern void __cons_klog_32_move_line_cells (struct cons *, size_t, size_t,
-					    size_t, size_t, size_t);
+extern struct cons_flush_stats __cons_flush_stats;
+extern void __cons_flush (struct cons *);
+extern void __cons_flush_sched (struct cons *);
+extern void __cons_flush_panic (void);
+extern void __cons_set_flush_rate (unsigned);
+extern unsigned __cons_get_flush_rate (void);
+extern size_t __cons_view (struct cons *, size_t);
+extern bool __cons_switch (unsigned);
+extern size_t __cons_scrollback_scratch_size (size_t);
+extern void __cons_scrollback_init (struct cons_scrollback *, void *, size_t,
+				    size_t);
+extern void __cons_scrollback_push (struct cons_scrollback *,
+				    const struct cons_cell *);
+extern size_t __cons_scrollback_find (const struct cons_scrollback *, size_t);
+extern size_t __cons_scrollback_get (struct cons_scrollback *, size_t,
+				     struct cons_cell *);
+extern void __cons_blit_init (void);
+/**
+ * @internal
+ * Fill LEN bytes at DEST with copies of a 32-bit PATTERN, or copy LEN bytes
+ * from SRC to DEST, where the areas do not overlap.  If STREAM is true, the
+ * destination is in the video frame buffer, & should be written using
+ * non-temporal stores.
+ */
+extern void (*__cons_fill_row) (void *, uint32_t, size_t, bool);
+extern void (*__cons_copy_row) (void *, const void *, size_t, bool);
+extern uint32_t __cons_klog_bgr565_map_color (cons_std_color_t);
+extern void __cons_klog_bgr565_draw_char (struct cons *, size_t, size_t,
+					  const struct cons_cell *);
+extern void __cons_klog_bgr565_draw_cells (struct cons *, size_t, size_t,
+					   const struct cons_cell *, size_t);
+extern void __cons_klog_bgr565_erase_line_cells (struct cons *, size_t,
+						 size_t, size_t, size_t);
+extern void __cons_klog_bgr565_move_line_cells (struct cons *, size_t,
+						size_t, size_t, size_t,
+						size_t, size_t);
+extern uint32_t __cons_klog_bgr555_map_color (cons_std_color_t);
+extern void __cons_klog_bgr555_draw_char (struct cons *, size_t, size_t,
+					  const struct cons_cell *);
+extern void __cons_klog_bgr555_draw_cells (struct cons *, size_t, size_t,
+					   const struct cons_cell *, size_t);
+extern void __cons_klog_bgr555_erase_line_cells (struct cons *, size_t,
+						 size_t, size_t, size_t);
+extern void __cons_klog_bgr555_move_line_cells (struct cons *, size_t,
+						size_t, size_t, size_t,
+						size_t, size_t);
+extern uint32_t __cons_klog_bgrx8888_map_color (cons_std_color_t);
+extern void __cons_klog_bgrx8888_draw_char (struct cons *, size_t, size_t,
+					    const struct cons_cell *);
+extern void __cons_klog_bgrx8888_draw_cells (struct cons *, size_t, size_t,
+					     const struct cons_cell *, size_t);
+extern void __cons_klog_bgrx8888_erase_line_cells (struct cons *, size_t,
+						   size_t, size_t, size_t);
+extern void __cons_klog_bgrx8888_move_line_cells (struct cons *, size_t,
+						  size_t, size_t, size_t,
+						  size_t, size_t);
+extern uint32_t __cons_klog_rgbx8888_map_color (cons_std_color_t);
+extern void __cons_klog_rgbx8888_draw_char (struct cons *, size_t, size_t,
+					    const struct cons_cell *);
+extern void __cons_klog_rgbx8888_draw_cells (struct cons *, size_t, size_t,
+					     const struct cons_cell *, size_t);
+extern void __cons_klog_rgbx8888_erase_line_cells (struct cons *, size_t,
+						   size_t, size_t, size_t);
+extern void __cons_klog_rgbx8888_move_line_cells (struct cons *, size_t,
+						  size_t, size_t, size_t,
+						  size_t, size_t);
 
 #endif
@@ -0,0 +1,243 @@
+/*
+ * Copyright (c) 2023 TK Chia
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+/**
+ * @internal
+ * @fileoverview Kernel log buffer.
+ *
+ * Code which wants to log something appends it to a lock-free ring buffer,
+ * which may be done from any context, including interrupt handlers.  The
+ * buffer is only rendered to the console later, in batches, when someone
+ * calls __klog_flush (.).
+ *
+ * The buffer holds a sequence of records, each starting on a 4-byte
+ * boundary with a 4-byte header.  A producer reserves space for a record
+ * by advancing head with a compare-and-swap, copies in its payload, & then
+ * publishes the record by storing its header.  The consumer processes
+ * records in order, stopping at the first one which is not yet published,
+ * & zeroes each record's space before handing it back to producers by
+ * advancing tail.
+ *
+ * If the buffer is too full to take a record, the record is dropped, & the
+ * number of bytes lost is counted.  The consumer reports the count the
+ * next time it runs.
+ *
+ * The consumer sends the log output to the framebuffer console, the serial
+ * port, or both, as selected by __klog_set_sinks (.).
+ */
+
+#include <inttypes.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+#include "cons.h"
+#include "klog.h"
+#include "serial.h"
+
+/** Header flag: record has been published. */
+#define KLOG_HDR_DONE	0x80000000U
+/** Header flag: record is padding to the end of the buffer. */
+#define KLOG_HDR_PAD	0x40000000U
+#define KLOG_HDR_LEN	0x0000ffffU
+
+_Static_assert ((KLOG_BUF_SIZE & (KLOG_BUF_SIZE - 1)) == 0,
+		"KLOG_BUF_SIZE should be a power of 2");
+_Static_assert (KLOG_MAX_RECORD <= KLOG_HDR_LEN
+		&& KLOG_MAX_RECORD <= KLOG_BUF_SIZE / 4,
+		"KLOG_MAX_RECORD too large");
+
+static struct
+  {
+    /** Total bytes ever reserved by producers. */
+    _Atomic uint64_t head;
+    /** Total bytes ever released by the consumer. */
+    _Atomic uint64_t tail;
+    /** Total bytes of payload dropped. */
+    _Atomic uint64_t lost;
+    /** Value of lost as of the last time the consumer reported it. */
+    uint64_t lost_seen;
+    /** Whether someone is currently consuming records. */
+    atomic_flag busy;
+    /** Where to send log output: a combination of KLOG_SINK_... flags. */
+    _Atomic unsigned sinks;
+    _Alignas (4) unsigned char buf[KLOG_BUF_SIZE];
+  } __klog = { .busy = ATOMIC_FLAG_INIT, .sinks = KLOG_SINK_CONS };
+
+static _Atomic uint32_t *
+__klog_hdr (uint64_t pos)
+{
+  return (_Atomic uint32_t *) (__klog.buf + (pos & (KLOG_BUF_SIZE - 1)));
+}
+
+static size_t
+__klog_rec_size (size_t len)
+{
+  return (sizeof (uint32_t) + len + 3) & ~(size_t) 3;
+}
+
+static void
+__klog_write_rec (const void *data, size_t n)
+{
+  size_t sz = __klog_rec_size (n), pad;
+  uint64_t pos, new_head;
+  do
+    {
+      pos = atomic_load_explicit (&__klog.head, memory_order_relaxed);
+      /*
+       * A record may not wrap around the end of the buffer; if it would,
+       * reserve the rest of the buffer as padding as well.
+       */
+      pad = KLOG_BUF_SIZE - (pos & (KLOG_BUF_SIZE - 1));
+      if (pad >= sz)
+	pad = 0;
+      new_head = pos + pad + sz;
+      if (new_head - atomic_load_explicit (&__klog.tail,
+					   memory_order_acquire)
+	  > KLOG_BUF_SIZE)
+	{
+	  atomic_fetch_add_explicit (&__klog.lost, n, memory_order_relaxed);
+	  return;
+	}
+    }
+  while (! atomic_compare_exchange_weak_explicit (&__klog.head, &pos,
+						  new_head,
+						  memory_order_relaxed,
+						  memory_order_relaxed));
+  if (pad)
+    {
+      atomic_store_explicit (__klog_hdr (pos),
+			     KLOG_HDR_DONE | KLOG_HDR_PAD | pad,
+			     memory_order_release);
+      pos += pad;
+    }
+  memcpy (__klog.buf + (pos & (KLOG_BUF_SIZE - 1)) + sizeof (uint32_t),
+	  data, n);
+  atomic_store_explicit (__klog_hdr (pos), KLOG_HDR_DONE | n,
+			 memory_order_release);
+}
+
+/**
+ * Set up the kernel log's output destinations: the framebuffer console,
+ * plus the first serial port if there is one.
+ */
+void
+__early_init_klog (void)
+{
+  unsigned sinks = KLOG_SINK_CONS;
+  if (__early_init_serial (SERIAL_COM1))
+    sinks |= KLOG_SINK_SERIAL;
+  __klog_set_sinks (sinks);
+}
+
+/**
+ * Select where kernel log output goes.  For example, passing just
+ * KLOG_SINK_SERIAL stops any rendering to the framebuffer console.
+ */
+void
+__klog_set_sinks (unsigned sinks)
+{
+  atomic_store_explicit (&__klog.sinks, sinks, memory_order_relaxed);
+}
+
+unsigned
+__klog_get_sinks (void)
+{
+  return atomic_load_explicit (&__klog.sinks, memory_order_relaxed);
+}
+
+static void
+__klog_emit (unsigned sinks, const void *data, size_t n)
+{
+  if ((sinks & KLOG_SINK_CONS) != 0)
+    __cons_put (&__console, data, n);
+  if ((sinks & KLOG_SINK_SERIAL) != 0)
+    __serial_write (data, n);
+}
+
+/**
+ * Append N bytes at DATA to the kernel log.  This never blocks.
+ */
+void
+__klog_write (const void *data, size_t n)
+{
+  const char *p = data;
+  while (n > KLOG_MAX_RECORD)
+    {
+      __klog_write_rec (p, KLOG_MAX_RECORD);
+      p += KLOG_MAX_RECORD;
+      n -= KLOG_MAX_RECORD;
+    }
+  if (n)
+    __klog_write_rec (p, n);
+}
+
+void
+__klog_puts (const char *s)
+{
+  __klog_write (s, strlen (s));
+}
+
+/**
+ * Return the total number of bytes of log output dropped so far.
+ */
+uint64_t
+__klog_lost (void)
+{
+  return atomic_load_explicit (&__klog.lost, memory_order_relaxed);
+}
+
+/**
+ * Send all published kernel log records to the log sinks, then ask for the
+ * video frame buffer to be updated, subject to the console's flush rate.  If
+ * another flush is already in progress, just return.
+ */
+void
+__klog_flush (void)
+{
+  uint64_t pos, head, lost;
+  unsigned sinks;
+  if (atomic_flag_test_and_set_explicit (&__klog.busy, memory_order_acquire))
+    return;
+  sinks = __klog_get_sinks ();
+  pos = atomic_load_explicit (&__klog.tail, memory_order_relaxed);
+  head = atomic_load_explicit (&__klog.head, memory_order_acquire);
+  while (pos != head)
+    {
+      _Atomic uint32_t *hdr = __klog_hdr (pos);
+      uint32_t h = atomic_load_explicit (hdr, memory_order_acquire);
+      size_t sz;
+      if ((h & KLOG_HDR_DONE) == 0)
+	break;
+      if ((h & KLOG_HDR_PAD) != 0)
+	sz = h & KLOG_HDR_LEN;
+      else
+	{
+	  size_t len = h & KLOG_HDR_LEN;
+	  __klog_emit (sinks, (char *) hdr + sizeof (uint32_t), len);
+	  sz = __klog_rec_size (len);
+	}
+      memset ((char *) hdr, 0, sz);
+      pos += sz;
+      atomic_store_explicit (&__klog.tail, pos, memory_order_release);
+    }
+  lost = __klog_lost ();
+  if (lost != __klog.lost_seen)
+    {
+      char msg[64];
+      int n = snprintf (msg, sizeof msg, "\n[klog: %" PRIu64 " bytes lost]\n",
+			lost - __klog.lost_seen);
+      __klog.lost_seen = lost;
+      __klog_emit (sinks, msg, (size_t) n);
+    }
+  if ((sinks & KLOG_SINK_CONS) != 0)
+    __cons_flush_sched (&__console);
+  if ((sinks & KLOG_SINK_SERIAL) != 0)
+    __serial_poll ();
+  atomic_flag_clear_explicit (&__klog.busy, memory_order_release);
+}
@@ -0,0 +1,42 @@
+/*
+ * Copyright (c) 2023 TK Chia
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+/**
+ * @internal Kernel log buffer.
+ */
+
+#ifndef _H_MACRON2_KLOG
+#define _H_MACRON2_KLOG
+
+#include <stddef.h>
+#include <stdint.h>
+
+/** Size of the kernel log ring buffer, in bytes.  Must be a power of 2. */
+#define KLOG_BUF_SIZE	0x10000
+/**
+ * Maximum payload size of a single log record.  Longer messages are split
+ * into several records.
+ */
+#define KLOG_MAX_RECORD	0x400
+
+/** Destinations to which kernel log output can be sent. */
+enum
+{
+  KLOG_SINK_CONS = 1 << 0,
+  KLOG_SINK_SERIAL = 1 << 1
+};
+
+extern void __early_init_klog (void);
+extern void __klog_set_sinks (unsigned);
+extern unsigned __klog_get_sinks (void);
+extern void __klog_write (const void *, size_t);
+extern void __klog_puts (const char *);
+extern void __klog_flush (void);
+extern uint64_t __klog_lost (void);
+
+#endif
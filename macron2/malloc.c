@@ -0,0 +1,97 @@
+/*
+ * Copyright (c) 2023 TK Chia
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+/**
+ * @internal
+ * @fileoverview C library memory allocation functions for stage 2.
+ *
+ * These are linked in ahead of the C library, & take the place of its own
+ * malloc (.) & friends, so that library code & kernel code allocate from
+ * the same slab allocator.  Like the slab allocator, they do not set
+ * errno.
+ */
+
+#include <errno.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "slab.h"
+
+void *
+malloc (size_t size)
+{
+  return __slab_alloc (size);
+}
+
+void
+free (void *p)
+{
+  __slab_free (p);
+}
+
+void *
+calloc (size_t n, size_t size)
+{
+  void *p;
+  if (size && n > SIZE_MAX / size)
+    return NULL;
+  p = __slab_alloc (n * size);
+  if (p)
+    memset (p, 0, n * size);
+  return p;
+}
+
+void *
+realloc (void *p, size_t size)
+{
+  size_t old_size;
+  void *q;
+  if (! p)
+    return __slab_alloc (size);
+  old_size = __slab_size (p);
+  if (size <= old_size)
+    return p;
+  q = __slab_alloc (size);
+  if (q)
+    {
+      memcpy (q, p, old_size);
+      __slab_free (p);
+    }
+  return q;
+}
+
+void *
+aligned_alloc (size_t align, size_t size)
+{
+  return __slab_alloc_aligned (align, size);
+}
+
+void *
+memalign (size_t align, size_t size)
+{
+  return __slab_alloc_aligned (align, size);
+}
+
+int
+posix_memalign (void **pp, size_t align, size_t size)
+{
+  void *p;
+  if (align < sizeof (void *) || (align & (align - 1)) != 0)
+    return EINVAL;
+  p = __slab_alloc_aligned (align, size);
+  if (! p)
+    return ENOMEM;
+  *pp = p;
+  return 0;
+}
+
+size_t
+malloc_usable_size (void *p)
+{
+  return p ? __slab_size (p) : 0;
+}
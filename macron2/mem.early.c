@@ -0,0 +1,58 @@
+/*
+ * Copyright (c) 2023 TK Chia
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#include <stdbool.h>
+#include "mem.h"
+#include "pc.h"
+#include "stage1.h"
+
+static bool
+__early_overlaps_reserve (const struct stage1 *stage1,
+			  uint64_t begin, uint64_t end)
+{
+  size_t i;
+  for (i = 0; i < stage1->reserves; ++i)
+    {
+      const struct boot_info_range *rs = __stage1_reserve (stage1, i);
+      if (begin < rs->end && rs->begin < end)
+	return true;
+    }
+  return false;
+}
+
+/**
+ * @internal
+ * Carve out a block of NPAGES pages of conventional memory, before any
+ * proper memory allocator is up.  The pages are taken from the top end of
+ * a suitable region in the UEFI memory map, & the memory map entry is
+ * shrunk accordingly, so that later allocators will not see the pages as
+ * free.  Return a pointer to the pages in high virtual memory, or NULL if
+ * there is no suitable region.
+ */
+void *
+__early_alloc_pages (const struct stage1 *stage1, size_t npages)
+{
+  size_t i, n = __mem_map_descs (stage1);
+  uint64_t len = (uint64_t) npages * PAGE_SIZE;
+  if (! npages)
+    return NULL;
+  for (i = 0; i < n; ++i)
+    {
+      struct efi_memory_descriptor *desc = __mem_map_desc (stage1, i);
+      uint64_t begin = desc->physical_start,
+	       end = begin + desc->pages * PAGE_SIZE;
+      if (desc->type != EFI_CONVENTIAL_MEMORY
+	  || desc->pages < npages
+	  || end - len < EARLY_ALLOC_MIN
+	  || __early_overlaps_reserve (stage1, end - len, end))
+	continue;
+      desc->pages -= npages;
+      return __early_map_memory (end - len, len);
+    }
+  return NULL;
+}
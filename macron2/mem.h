@@ -0,0 +1,46 @@
+/*
+ * Copyright (c) 2023 TK Chia
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#ifndef _H_MACRON2_MEM
+#define _H_MACRON2_MEM
+
+#include <stddef.h>
+#include <stdint.h>
+#include "stage1.h"
+
+#define PAGE_SIZE	0x1000
+
+/**
+ * @internal
+ * Lowest physical address which we will hand out from the early allocator.
+ * Memory below this is left alone, since we may need it later to run
+ * real mode code.
+ */
+#define EARLY_ALLOC_MIN	0x100000
+
+static inline struct efi_memory_descriptor *
+__mem_map_desc (const struct stage1 *__stage1, size_t __i)
+{
+  return (struct efi_memory_descriptor *)
+	 ((char *) __stage1->mem_map + __i * __stage1->mem_map_desc_size);
+}
+
+static inline size_t
+__mem_map_descs (const struct stage1 *__stage1)
+{
+  return __stage1->mem_map_size / __stage1->mem_map_desc_size;
+}
+
+extern uint64_t __direct_map_end;
+
+extern void *__early_alloc_pages (const struct stage1 *, size_t);
+extern uint64_t __early_init_paging (const struct stage1 *);
+extern void __early_finish_paging (void);
+extern uint64_t *__paging_pml4 (void);
+
+#endif
@@ -0,0 +1,243 @@
+/*
+ * Copyright (c) 2023 TK Chia
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+/**
+ * @internal
+ * @fileoverview Mappings of device memory.
+ *
+ * Device memory is mapped separately from the direct map, in the range
+ * [MMIO_BASE, MMIO_BASE + MMIO_SIZE), with a memory type chosen by the
+ * caller.  The memory type is set through the PAT, which
+ * __early_init_pat (.) programs as follows:
+ *
+ *	PAT index 0 (no flags)		write-back, as at reset
+ *	PAT index 1 (PWT)		write-combining, instead of write-through
+ *	PAT index 3 (PCD | PWT)		uncacheable, as at reset
+ *
+ * If the CPU has no PAT, write-combining mappings are made uncacheable.
+ *
+ * Each mapping is remembered, so that mapping the same device memory again
+ * with the same type gives back the same virtual address.  Mappings are
+ * never removed.
+ */
+
+#include <cpuid.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <string.h>
+#include "mem.h"
+#include "mmio.h"
+#include "page.h"
+#include "pc.h"
+
+/** CPUID 1 %edx bit: the PAT is supported. */
+#define CPUID_PAT	(1U << 16)
+/** PAT memory type for write-combining. */
+#define PAT_WC		0x01
+
+#define PAGE_2M		((uint64_t) 1 << 21)
+#define PT_ENTRIES	(PAGE_SIZE / sizeof (uint64_t))
+
+struct mmio_map
+{
+  uint64_t pa, len;
+  uintptr_t va;
+  enum mmio_type type;
+};
+
+static struct
+  {
+    /** Lock on everything below. */
+    atomic_flag lock;
+    /** Whether PAT index 1 has been set to write-combining. */
+    bool pat_wc;
+    /** Next free virtual address for mappings. */
+    uintptr_t next;
+    size_t maps, pool_used;
+    struct mmio_map map[MMIO_MAX_MAPS];
+  } __mmio = { .lock = ATOMIC_FLAG_INIT, .next = MMIO_BASE };
+
+static _Alignas (PAGE_SIZE) uint64_t __mmio_pool[MMIO_POOL_PAGES][PT_ENTRIES];
+
+/**
+ * Program PAT index 1 as write-combining.  This should be called once, with
+ * interrupts disabled, & followed by a TLB flush.
+ */
+void
+__early_init_pat (void)
+{
+  unsigned eax, ebx, ecx, edx;
+  uint64_t pat;
+  __cpuid (1, eax, ebx, ecx, edx);
+  if ((edx & CPUID_PAT) == 0)
+    return;
+  pat = __rdmsr (MSR_PAT);
+  pat = (pat & ~(uint64_t) 0xff00) | (uint64_t) PAT_WC << 8;
+  __wbinvd ();
+  __wrmsr (MSR_PAT, pat);
+  __wbinvd ();
+  __mmio.pat_wc = true;
+}
+
+static void
+__mmio_lock (void)
+{
+  while (atomic_flag_test_and_set_explicit (&__mmio.lock,
+					    memory_order_acquire))
+    __pause ();
+}
+
+static void
+__mmio_unlock (void)
+{
+  atomic_flag_clear_explicit (&__mmio.lock, memory_order_release);
+}
+
+static uint64_t
+__mmio_pte_flags (enum mmio_type type)
+{
+  switch (type)
+    {
+    case MMIO_WB:
+      return 0;
+    case MMIO_WC:
+      if (__mmio.pat_wc)
+	return PTE_PWT;
+      /* fall through */
+    default:
+      return PTE_PCD | PTE_PWT;
+    }
+}
+
+/**
+ * @internal
+ * Return the page table which the page table entry at PTE points to,
+ * creating it if it does not exist yet.  Take new page tables from the page
+ * allocator, or failing that, from __mmio_pool.  Return NULL if there is no
+ * memory.
+ */
+static uint64_t *
+__mmio_table (uint64_t *pte)
+{
+  uint64_t *table;
+  if ((*pte & PTE_P) != 0)
+    return __early_map_memory (*pte & PTE_ADDR, PAGE_SIZE);
+  table = __page_alloc_one ();
+  if (! table)
+    {
+      if (__mmio.pool_used == MMIO_POOL_PAGES)
+	return NULL;
+      table = __mmio_pool[__mmio.pool_used++];
+    }
+  memset (table, 0, PAGE_SIZE);
+  *pte = ((uintptr_t) table - BANE) | PTE_P | PTE_W;
+  return table;
+}
+
+/**
+ * @internal
+ * Map the LEN bytes of device memory at PA to VA, with page table entry
+ * flags FLAGS.  PA, VA, & LEN should be page aligned.  Use 2 MiB pages
+ * where possible.
+ */
+static bool
+__mmio_map_range (uint64_t pa, uintptr_t va, uint64_t len, uint64_t flags)
+{
+  uint64_t *pml4 = __paging_pml4 ();
+  while (len != 0)
+    {
+      uint64_t *pdpt, *pd, *pt;
+      pdpt = __mmio_table (&pml4[va >> 39 & (PT_ENTRIES - 1)]);
+      if (! pdpt)
+	return false;
+      pd = __mmio_table (&pdpt[va >> 30 & (PT_ENTRIES - 1)]);
+      if (! pd)
+	return false;
+      if (pa % PAGE_2M == 0 && va % PAGE_2M == 0 && len >= PAGE_2M)
+	{
+	  pd[va >> 21 & (PT_ENTRIES - 1)] = pa | flags | PTE_PS;
+	  pa += PAGE_2M;
+	  va += PAGE_2M;
+	  len -= PAGE_2M;
+	  continue;
+	}
+      pt = __mmio_table (&pd[va >> 21 & (PT_ENTRIES - 1)]);
+      if (! pt)
+	return false;
+      pt[va >> 12 & (PT_ENTRIES - 1)] = pa | flags;
+      pa += PAGE_SIZE;
+      va += PAGE_SIZE;
+      len -= PAGE_SIZE;
+    }
+  return true;
+}
+
+/**
+ * @internal
+ * Map the device memory in [BEGIN, END), which should be page aligned,
+ * with memory type TYPE, & return the virtual address of BEGIN, or 0.  The
+ * caller should hold the lock.
+ */
+static uintptr_t
+__mmio_map_locked (uint64_t begin, uint64_t end, enum mmio_type type)
+{
+  uintptr_t va;
+  struct mmio_map *m;
+  size_t i;
+  for (i = 0; i < __mmio.maps; ++i)
+    {
+      m = &__mmio.map[i];
+      if (begin >= m->pa + m->len || m->pa >= end)
+	continue;
+      if (m->type != type)
+	return 0;
+      if (m->pa <= begin && end <= m->pa + m->len)
+	return m->va + (begin - m->pa);
+    }
+  if (__mmio.maps == MMIO_MAX_MAPS)
+    return 0;
+  /*
+   * Give the mapping the same alignment as the physical address, modulo
+   * 2 MiB, so that large mappings can use 2 MiB pages.
+   */
+  va = __mmio.next;
+  if (end - begin >= PAGE_2M)
+    va = ((va + PAGE_2M - 1) & ~(PAGE_2M - 1)) + begin % PAGE_2M;
+  if (va + (end - begin) > MMIO_BASE + MMIO_SIZE
+      || ! __mmio_map_range (begin, va, end - begin,
+			     PTE_P | PTE_W | PTE_G | __mmio_pte_flags (type)))
+    return 0;
+  m = &__mmio.map[__mmio.maps++];
+  m->pa = begin;
+  m->len = end - begin;
+  m->va = va;
+  m->type = type;
+  __mmio.next = va + (end - begin);
+  return va;
+}
+
+/**
+ * Map the LEN bytes of device memory at physical address PA, with memory
+ * type TYPE, & return a pointer to the mapping.  If the memory is already
+ * mapped with the same type, return the existing mapping.  Return NULL if
+ * the memory is already mapped with a different type, or if the mapping
+ * cannot be made.
+ */
+void *
+__mmio_map (uint64_t pa, size_t len, enum mmio_type type)
+{
+  uint64_t begin = pa & ~(uint64_t) (PAGE_SIZE - 1),
+	   end = (pa + len + PAGE_SIZE - 1) & ~(uint64_t) (PAGE_SIZE - 1);
+  uintptr_t va;
+  if (! len)
+    return NULL;
+  __mmio_lock ();
+  va = __mmio_map_locked (begin, end, type);
+  __mmio_unlock ();
+  return va ? (void *) (va + (pa - begin)) : NULL;
+}
@@ -0,0 +1,45 @@
+/*
+ * Copyright (c) 2023 TK Chia
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+/**
+ * @internal Mappings of device memory.
+ */
+
+#ifndef _H_MACRON2_MMIO
+#define _H_MACRON2_MMIO
+
+#include <stddef.h>
+#include <stdint.h>
+
+/** Start of the virtual address range for device memory mappings. */
+#define MMIO_BASE	0xffffff0000000000
+/** Size of the virtual address range for device memory mappings. */
+#define MMIO_SIZE	0x0000008000000000
+/** Maximum number of device memory mappings. */
+#define MMIO_MAX_MAPS	32
+/**
+ * Number of page tables set aside for device memory mappings made before
+ * the page allocator is up.
+ */
+#define MMIO_POOL_PAGES	16
+
+/** Memory types for device memory mappings. */
+enum mmio_type
+{
+  /** Uncacheable, for device registers. */
+  MMIO_UC,
+  /** Write-combining, for frame buffers. */
+  MMIO_WC,
+  /** Write-back. */
+  MMIO_WB
+};
+
+extern void __early_init_pat (void);
+extern void *__mmio_map (uint64_t, size_t, enum mmio_type);
+
+#endif
@@ -0,0 +1,586 @@
+/*
+ * Copyright (c) 2023 TK Chia
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+/**
+ * @internal
+ * @fileoverview Physical page frame allocator.
+ *
+ * This is a binary buddy allocator.  A free block of 2 ** k pages, for
+ * some order k up to PAGE_MAX_ORDER, is always aligned to its own size, &
+ * sits on the free list for order k.  The free lists are threaded through
+ * the free pages themselves.  A bitmap for each order records which blocks
+ * are on that order's free list, so that freeing a block can tell at once
+ * whether its buddy is also free & the two can be merged.
+ *
+ * On top of this, each processor keeps a small magazine of single free
+ * pages, which it can allocate from & free to without taking the lock on
+ * the free lists.  A processor goes to the free lists only to refill an
+ * empty magazine, or to drain a full one, & then moves half a magazine's
+ * worth of pages at a time.
+ *
+ * Once stage 2 no longer needs anything which stage 1 left behind, the
+ * UEFI boot services memory & loader data are also handed to the free
+ * lists.  This memory is not zeroed then, since that would make booting
+ * slower; instead a bitmap records which pages are still "stale", & a
+ * stale page is zeroed when it is first allocated.
+ *
+ * Pages are handed out as pointers into the direct map of physical memory
+ * at BANE.
+ */
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+#include "klog.h"
+#include "page.h"
+#include "pc.h"
+
+struct page_free
+{
+  struct page_free *next, *prev;
+};
+
+struct page_mag
+{
+  unsigned n;
+  uint64_t hits, misses;
+  void *page[PAGE_MAG_SIZE];
+};
+
+static struct
+  {
+    /** Lock on everything below. */
+    atomic_flag lock;
+    /** Page frame number one past the highest page we may manage. */
+    uint64_t npfn;
+    size_t free, total, reclaimed;
+    struct page_free *list[PAGE_MAX_ORDER + 1];
+    /** Bit N of map[K] is set if the block at page frame N << K is free. */
+    uint64_t *map[PAGE_MAX_ORDER + 1];
+    /** Bit N is set if page frame N was reclaimed & is not yet zeroed. */
+    _Atomic uint64_t *stale;
+  } __page = { .lock = ATOMIC_FLAG_INIT };
+
+static struct page_mag __page_mags[MAX_CPUS];
+
+/** Start & end of the stage 2 image, from the linker. */
+extern const char __ehdr_start[], _end[];
+
+static void
+__page_lock (void)
+{
+  while (atomic_flag_test_and_set_explicit (&__page.lock,
+					    memory_order_acquire))
+    __pause ();
+}
+
+static void
+__page_unlock (void)
+{
+  atomic_flag_clear_explicit (&__page.lock, memory_order_release);
+}
+
+static struct page_free *
+__page_virt (uint64_t pfn)
+{
+  return (struct page_free *) (BANE + pfn * PAGE_SIZE);
+}
+
+static uint64_t
+__page_pfn (const void *p)
+{
+  return ((uintptr_t) p - BANE) / PAGE_SIZE;
+}
+
+static bool
+__page_test (unsigned order, uint64_t pfn)
+{
+  uint64_t i = pfn >> order;
+  return (__page.map[order][i / 64] >> i % 64 & 1) != 0;
+}
+
+static void
+__page_flip (unsigned order, uint64_t pfn)
+{
+  uint64_t i = pfn >> order;
+  __page.map[order][i / 64] ^= (uint64_t) 1 << i % 64;
+}
+
+static void
+__page_push (unsigned order, uint64_t pfn)
+{
+  struct page_free *blk = __page_virt (pfn), *next = __page.list[order];
+  blk->next = next;
+  blk->prev = NULL;
+  if (next)
+    next->prev = blk;
+  __page.list[order] = blk;
+  __page_flip (order, pfn);
+}
+
+static void
+__page_unlink (unsigned order, struct page_free *blk)
+{
+  if (blk->prev)
+    blk->prev->next = blk->next;
+  else
+    __page.list[order] = blk->next;
+  if (blk->next)
+    blk->next->prev = blk->prev;
+  __page_flip (order, __page_pfn (blk));
+}
+
+/**
+ * @internal
+ * Put the block of 2 ** ORDER pages at page frame PFN on the free lists,
+ * merging it with its buddy for as long as the buddy is also free.  The
+ * caller should hold the lock.
+ */
+static void
+__page_free_locked (uint64_t pfn, unsigned order)
+{
+  __page.free += (size_t) 1 << order;
+  while (order < PAGE_MAX_ORDER)
+    {
+      uint64_t buddy = pfn ^ (uint64_t) 1 << order;
+      if (buddy >= __page.npfn || ! __page_test (order, buddy))
+	break;
+      __page_unlink (order, __page_virt (buddy));
+      pfn &= ~((uint64_t) 1 << order);
+      ++order;
+    }
+  __page_push (order, pfn);
+}
+
+/**
+ * @internal
+ * Zero any stale pages in the newly allocated block of 2 ** ORDER pages at
+ * page frame PFN.  The caller need not hold the lock.
+ */
+static void
+__page_scrub (uint64_t pfn, unsigned order)
+{
+  uint64_t end = pfn + ((uint64_t) 1 << order);
+  while (pfn < end)
+    {
+      _Atomic uint64_t *word = &__page.stale[pfn / 64];
+      unsigned shift = pfn % 64;
+      uint64_t n = end - pfn < 64 - shift ? end - pfn : 64 - shift,
+	       mask = (n == 64 ? ~(uint64_t) 0
+			       : ((uint64_t) 1 << n) - 1) << shift, bits;
+      if ((atomic_load_explicit (word, memory_order_relaxed) & mask) != 0)
+	{
+	  bits = atomic_fetch_and_explicit (word, ~mask,
+					    memory_order_relaxed) & mask;
+	  while (bits)
+	    {
+	      unsigned bit = __builtin_ctzll (bits);
+	      memset (__page_virt (pfn - shift + bit), 0, PAGE_SIZE);
+	      bits &= bits - 1;
+	    }
+	}
+      pfn += n;
+    }
+}
+
+/**
+ * @internal
+ * Take a block of 2 ** ORDER pages off the free lists, splitting a larger
+ * block if need be.  Return its page frame number, or 0 if there is no
+ * block large enough.  (Page frame 0 is never free.)  The caller should
+ * hold the lock.
+ */
+static uint64_t
+__page_alloc_locked (unsigned order)
+{
+  unsigned k = order;
+  struct page_free *blk;
+  uint64_t pfn;
+  while (! __page.list[k])
+    if (++k > PAGE_MAX_ORDER)
+      return 0;
+  blk = __page.list[k];
+  __page_unlink (k, blk);
+  pfn = __page_pfn (blk);
+  while (k > order)
+    {
+      --k;
+      __page_push (k, pfn + ((uint64_t) 1 << k));
+    }
+  __page.free -= (size_t) 1 << order;
+  return pfn;
+}
+
+/**
+ * @internal
+ * Hand the pages in the physical address range [BEGIN, END) to the free
+ * lists, as blocks which are as large as their alignment allows.  BEGIN &
+ * END need not be page aligned; partial pages are left out.
+ */
+static void
+__early_page_add_range (uint64_t begin, uint64_t end)
+{
+  uint64_t pfn = (begin + PAGE_SIZE - 1) / PAGE_SIZE,
+	   end_pfn = end / PAGE_SIZE;
+  while (pfn < end_pfn)
+    {
+      unsigned order = 0;
+      while (order < PAGE_MAX_ORDER
+	     && (pfn & (uint64_t) 1 << order) == 0
+	     && pfn + ((uint64_t) 2 << order) <= end_pfn)
+	++order;
+      __page_free_locked (pfn, order);
+      __page.total += (size_t) 1 << order;
+      pfn += (uint64_t) 1 << order;
+    }
+}
+
+/**
+ * @internal
+ * Hand the physical address range [BEGIN, END) to the free lists, minus
+ * any parts of it which overlap the stage 1 reserved blocks from index I
+ * onwards.
+ */
+static void
+__early_page_add_unreserved (const struct stage1 *stage1, size_t i,
+			     uint64_t begin, uint64_t end)
+{
+  for (; i < stage1->reserves; ++i)
+    {
+      const struct boot_info_range *rs = __stage1_reserve (stage1, i);
+      if (begin < rs->end && rs->begin < end)
+	{
+	  if (begin < rs->begin)
+	    __early_page_add_unreserved (stage1, i + 1, begin, rs->begin);
+	  if (rs->end < end)
+	    __early_page_add_unreserved (stage1, i + 1, rs->end, end);
+	  return;
+	}
+    }
+  if (begin < end)
+    __early_page_add_range (begin, end);
+}
+
+static bool
+__early_page_reclaimable (const struct efi_memory_descriptor *desc)
+{
+  switch (desc->type)
+    {
+    case EFI_BOOT_SERVICES_CODE:
+    case EFI_BOOT_SERVICES_DATA:
+    case EFI_LOADER_DATA:
+      return true;
+    default:
+      return false;
+    }
+}
+
+/**
+ * Set up the page frame allocator to manage all the conventional memory in
+ * the UEFI memory map, apart from the stage 1 reserved blocks & memory
+ * below EARLY_ALLOC_MIN.  After this, __early_alloc_pages (.) should no
+ * longer be used.  The allocator also leaves room to manage the memory
+ * which __early_reclaim_page (.) may later hand to it.
+ */
+void
+__early_init_page (const struct stage1 *stage1)
+{
+  size_t i, n = __mem_map_descs (stage1), map_words = 0;
+  uint64_t npfn = 0, *map;
+  unsigned order;
+  char msg[80];
+  int len;
+  for (i = 0; i < n; ++i)
+    {
+      const struct efi_memory_descriptor *desc = __mem_map_desc (stage1, i);
+      uint64_t end_pfn = desc->physical_start / PAGE_SIZE + desc->pages;
+      if ((desc->type == EFI_CONVENTIAL_MEMORY
+	   || __early_page_reclaimable (desc))
+	  && end_pfn > npfn)
+	npfn = end_pfn;
+    }
+  for (order = 0; order <= PAGE_MAX_ORDER; ++order)
+    map_words += (npfn >> order) / 64 + 1;
+  map_words += npfn / 64 + 1;
+  map = __early_alloc_pages (stage1, (map_words * sizeof (uint64_t)
+				      + PAGE_SIZE - 1) / PAGE_SIZE);
+  if (! map)
+    {
+      __klog_puts ("page: no memory for allocator bitmap\n");
+      return;
+    }
+  memset (map, 0, map_words * sizeof (uint64_t));
+  for (order = 0; order <= PAGE_MAX_ORDER; ++order)
+    {
+      __page.map[order] = map;
+      map += (npfn >> order) / 64 + 1;
+    }
+  __page.stale = (_Atomic uint64_t *) map;
+  __page.npfn = npfn;
+  for (i = 0; i < n; ++i)
+    {
+      const struct efi_memory_descriptor *desc = __mem_map_desc (stage1, i);
+      uint64_t begin = desc->physical_start,
+	       end = begin + desc->pages * PAGE_SIZE;
+      if (desc->type != EFI_CONVENTIAL_MEMORY || end <= EARLY_ALLOC_MIN)
+	continue;
+      if (begin < EARLY_ALLOC_MIN)
+	begin = EARLY_ALLOC_MIN;
+      __early_page_add_unreserved (stage1, 0, begin, end);
+    }
+  len = snprintf (msg, sizeof msg, "page: %zu KiB free\n",
+		  __page.free * (PAGE_SIZE / 1024));
+  __klog_write (msg, (size_t) len);
+}
+
+/**
+ * Allocate a stack for stage 2 to use instead of the one it was started
+ * on, which is in memory that __early_reclaim_page (.) will free.  Return
+ * a pointer to the top of the stack, or NULL if there is no memory.
+ */
+void *
+__early_page_stack (void)
+{
+  char *stack = __page_alloc (PAGE_STACK_ORDER);
+  if (! stack)
+    return NULL;
+  return stack + ((size_t) PAGE_SIZE << PAGE_STACK_ORDER);
+}
+
+/**
+ * @internal
+ * Mark the page frames in [BEGIN, END) as stale or not stale.
+ */
+static void
+__early_page_mark (uint64_t begin, uint64_t end, bool stale)
+{
+  uint64_t pfn = begin / PAGE_SIZE,
+	   end_pfn = (end + PAGE_SIZE - 1) / PAGE_SIZE;
+  if (end_pfn > __page.npfn)
+    end_pfn = __page.npfn;
+  for (; pfn < end_pfn; ++pfn)
+    {
+      uint64_t bit = (uint64_t) 1 << pfn % 64;
+      if (stale)
+	atomic_fetch_or_explicit (&__page.stale[pfn / 64], bit,
+				  memory_order_relaxed);
+      else
+	atomic_fetch_and_explicit (&__page.stale[pfn / 64], ~bit,
+				   memory_order_relaxed);
+    }
+}
+
+/**
+ * @internal
+ * Unmark the page table at physical address TABLE, at paging level LEVEL
+ * (1 for a page table proper, 4 for a PML4 table), & all the tables below
+ * it.
+ */
+static void
+__early_page_keep_tables (uint64_t table, unsigned level)
+{
+  const uint64_t *pte = __early_map_memory (table, PAGE_SIZE);
+  unsigned i;
+  __early_page_mark (table, table + PAGE_SIZE, false);
+  if (level == 1)
+    return;
+  for (i = 0; i < PAGE_SIZE / sizeof (uint64_t); ++i)
+    {
+      uint64_t e = pte[i];
+      if ((e & PTE_P) == 0 || (level <= 3 && (e & PTE_PS) != 0))
+	continue;
+      __early_page_keep_tables (e & PTE_ADDR, level - 1);
+    }
+}
+
+static void
+__early_page_keep_desc_table (struct pc_desc_table t)
+{
+  uint64_t base = t.base >= BANE ? t.base - BANE : t.base;
+  __early_page_mark (base, base + t.limit + 1, false);
+}
+
+/**
+ * Hand the UEFI boot services memory & loader data from the memory map in
+ * STAGE1 to the page allocator, apart from the stage 1 reserved blocks, &
+ * anything which the processor is still using: the current page tables,
+ * GDT, & IDT.  The pages are zeroed lazily, by __page_scrub (.).
+ *
+ * This should only be called once nothing else needs any of the data which
+ * stage 1 passed in, including STAGE1 itself, & after switching to the
+ * stack from __early_page_stack (.).
+ */
+void
+__early_reclaim_page (const struct stage1 *stage1)
+{
+  size_t i, n = __mem_map_descs (stage1), before;
+  uint64_t pfn, end_pfn;
+  char msg[80];
+  int len;
+  if (! __page.stale)
+    return;
+  /*
+   * First mark what we will free, while the memory map & reserved block
+   * list are still intact.
+   */
+  for (i = 0; i < n; ++i)
+    {
+      const struct efi_memory_descriptor *desc = __mem_map_desc (stage1, i);
+      uint64_t begin = desc->physical_start,
+	       end = begin + desc->pages * PAGE_SIZE;
+      if (__early_page_reclaimable (desc) && end > EARLY_ALLOC_MIN)
+	__early_page_mark (begin < EARLY_ALLOC_MIN ? EARLY_ALLOC_MIN : begin,
+			   end, true);
+    }
+  for (i = 0; i < stage1->reserves; ++i)
+    {
+      const struct boot_info_range *rs = __stage1_reserve (stage1, i);
+      __early_page_mark (rs->begin, rs->end, false);
+    }
+  __early_page_mark ((uintptr_t) __ehdr_start - BANE,
+		     (uintptr_t) _end - BANE, false);
+  __early_page_keep_tables (__read_cr3 () & PTE_ADDR,
+			    (__read_cr4 () & CR4_VA57) != 0 ? 5 : 4);
+  __early_page_keep_desc_table (__sgdt ());
+  __early_page_keep_desc_table (__sidt ());
+  /* Then free each run of marked pages. */
+  __page_lock ();
+  before = __page.total;
+  pfn = 0;
+  while (pfn < __page.npfn)
+    {
+      uint64_t word = atomic_load_explicit (&__page.stale[pfn / 64],
+					    memory_order_relaxed)
+		      >> pfn % 64;
+      if (! word)
+	{
+	  pfn = (pfn / 64 + 1) * 64;
+	  continue;
+	}
+      pfn += __builtin_ctzll (word);
+      end_pfn = pfn + 1;
+      while (end_pfn < __page.npfn
+	     && (atomic_load_explicit (&__page.stale[end_pfn / 64],
+				       memory_order_relaxed)
+		 >> end_pfn % 64 & 1) != 0)
+	++end_pfn;
+      __early_page_add_range (pfn * PAGE_SIZE, end_pfn * PAGE_SIZE);
+      pfn = end_pfn;
+    }
+  __page.reclaimed += __page.total - before;
+  __page_unlock ();
+  len = snprintf (msg, sizeof msg, "page: %zu KiB reclaimed\n",
+		  (__page.total - before) * (PAGE_SIZE / 1024));
+  __klog_write (msg, (size_t) len);
+}
+
+/**
+ * Allocate a block of 2 ** ORDER physically contiguous pages, aligned to
+ * its size.  Return a pointer to it, or NULL if there is no such block.
+ */
+void *
+__page_alloc (unsigned order)
+{
+  uint64_t pfn;
+  if (order > PAGE_MAX_ORDER)
+    return NULL;
+  __page_lock ();
+  pfn = __page_alloc_locked (order);
+  __page_unlock ();
+  if (! pfn)
+    return NULL;
+  __page_scrub (pfn, order);
+  return __page_virt (pfn);
+}
+
+/**
+ * Free the block of 2 ** ORDER pages at P, which should have come from
+ * __page_alloc (ORDER).
+ */
+void
+__page_free (void *p, unsigned order)
+{
+  if (! p)
+    return;
+  __page_lock ();
+  __page_free_locked (__page_pfn (p), order);
+  __page_unlock ();
+}
+
+/**
+ * Allocate a single page, preferably from this processor's magazine.
+ * Return a pointer to it, or NULL if there are no free pages.
+ */
+void *
+__page_alloc_one (void)
+{
+  struct page_mag *mag = &__page_mags[__this_cpu ()];
+  void *p;
+  if (mag->n == 0)
+    {
+      ++mag->misses;
+      __page_lock ();
+      while (mag->n < PAGE_MAG_SIZE / 2)
+	{
+	  uint64_t pfn = __page_alloc_locked (0);
+	  if (! pfn)
+	    break;
+	  mag->page[mag->n++] = __page_virt (pfn);
+	}
+      __page_unlock ();
+      if (mag->n == 0)
+	return NULL;
+    }
+  else
+    ++mag->hits;
+  p = mag->page[--mag->n];
+  __page_scrub (__page_pfn (p), 0);
+  return p;
+}
+
+/**
+ * Free a single page at P, which may have come from either
+ * __page_alloc_one (.) or __page_alloc (0).
+ */
+void
+__page_free_one (void *p)
+{
+  struct page_mag *mag = &__page_mags[__this_cpu ()];
+  if (! p)
+    return;
+  if (mag->n == PAGE_MAG_SIZE)
+    {
+      __page_lock ();
+      while (mag->n > PAGE_MAG_SIZE / 2)
+	__page_free_locked (__page_pfn (mag->page[--mag->n]), 0);
+      __page_unlock ();
+    }
+  mag->page[mag->n++] = p;
+}
+
+/**
+ * Fill in STATS with the page allocator's current statistics.
+ */
+void
+__page_get_stats (struct page_stats *stats)
+{
+  unsigned cpu;
+  memset (stats, 0, sizeof (*stats));
+  __page_lock ();
+  stats->free = __page.free;
+  stats->total = __page.total;
+  stats->reclaimed = __page.reclaimed;
+  __page_unlock ();
+  for (cpu = 0; cpu < MAX_CPUS; ++cpu)
+    {
+      stats->free += __page_mags[cpu].n;
+      stats->mag_hits += __page_mags[cpu].hits;
+      stats->mag_misses += __page_mags[cpu].misses;
+    }
+}
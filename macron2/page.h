@@ -0,0 +1,52 @@
+/*
+ * Copyright (c) 2023 TK Chia
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+/**
+ * @internal Physical page frame allocator.
+ */
+
+#ifndef _H_MACRON2_PAGE
+#define _H_MACRON2_PAGE
+
+#include <stddef.h>
+#include <stdint.h>
+#include "mem.h"
+#include "stage1.h"
+
+/** Largest block which the page allocator deals in is 2 ** this pages. */
+#define PAGE_MAX_ORDER	18
+/** Number of single pages which each processor's magazine can hold. */
+#define PAGE_MAG_SIZE	32
+/** Stage 2's own stack is 2 ** this pages. */
+#define PAGE_STACK_ORDER 4
+
+/** Page allocator statistics. */
+struct page_stats
+{
+  /** Number of pages which are free, including those in magazines. */
+  size_t free;
+  /** Total number of pages ever handed to the allocator. */
+  size_t total;
+  /** Number of those pages which were reclaimed from stage 1. */
+  size_t reclaimed;
+  /** Number of single page requests satisfied from magazines. */
+  uint64_t mag_hits;
+  /** Number of single page requests which had to go to the free lists. */
+  uint64_t mag_misses;
+};
+
+extern void __early_init_page (const struct stage1 *);
+extern void *__early_page_stack (void);
+extern void __early_reclaim_page (const struct stage1 *);
+extern void *__page_alloc (unsigned);
+extern void __page_free (void *, unsigned);
+extern void *__page_alloc_one (void);
+extern void __page_free_one (void *);
+extern void __page_get_stats (struct page_stats *);
+
+#endif
@@ -0,0 +1,433 @@
+/*
+ * Copyright (c) 2023 TK Chia
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+/**
+ * @internal
+ * @fileoverview Stage 2's own page tables.
+ *
+ * These map all the RAM in the memory map at BANE, using 1 GiB pages
+ * where the CPU supports them & the RAM covers them, 2 MiB pages where
+ * possible, & 4 KiB pages elsewhere.  Holes in the memory map, including
+ * memory-mapped I/O & the frame buffer, are left out, so that no large
+ * page spans memory of different types; __mmio_map (.) maps those instead.
+ * The pages which hold only stage 2 text & read-only data are marked
+ * global, so that they stay in the TLB across any later %cr3 switches.
+ *
+ * __early_init_paging (.) runs under the firmware's identity mapping, &
+ * builds the tables in memory carved out with __early_alloc_pages (.).  For
+ * the switch-over, the tables also map the same memory at its identity
+ * address.  _start loads the new %cr3 once, jumps to the high mapping, &
+ * calls __early_finish_paging (.) to remove the identity mapping again.
+ *
+ * If stage 1 has already built suitable tables, __early_init_paging (.)
+ * just hands those back instead.
+ */
+
+#include <cpuid.h>
+#include <stdbool.h>
+#include <string.h>
+#include "mem.h"
+#include "mmio.h"
+#include "pc.h"
+
+/** CPUID 0x80000001 %edx bit: 1 GiB pages are supported. */
+#define CPUID_PDPE1GB	(1U << 26)
+
+#define PAGE_2M		((uint64_t) 1 << 21)
+#define PAGE_1G		((uint64_t) 1 << 30)
+#define PML4E_SPAN	((uint64_t) 1 << 39)
+#define PT_ENTRIES	(PAGE_SIZE / sizeof (uint64_t))
+
+/** Start of the stage 2 image, end of its read-only data, & its end. */
+extern const char __ehdr_start[], _erodata[], _end[];
+
+/** End of the highest RAM covered by the direct map at BANE. */
+uint64_t __direct_map_end;
+
+/**
+ * @internal
+ * Return the physical address of the thing at P, which may be either in
+ * the direct map or in the firmware's identity mapping.
+ */
+static uint64_t
+__early_paging_phys (const void *p)
+{
+  uintptr_t addr = (uintptr_t) p;
+  return addr >= BANE ? addr - BANE : addr;
+}
+
+/**
+ * @internal
+ * Allocate a zeroed page table, & return its physical address, which is
+ * also its address under the identity mapping.  Return NULL if there is no
+ * memory.
+ */
+static uint64_t *
+__early_paging_table (const struct stage1 *stage1)
+{
+  void *p = __early_alloc_pages (stage1, 1);
+  uint64_t *table;
+  if (! p)
+    return NULL;
+  table = (uint64_t *) (uintptr_t) __early_paging_phys (p);
+  memset (table, 0, PAGE_SIZE);
+  return table;
+}
+
+static bool
+__early_paging_has_1g (void)
+{
+  unsigned eax, ebx, ecx, edx;
+  if (__get_cpuid_max (0x80000000, NULL) < 0x80000001)
+    return false;
+  __cpuid (0x80000001, eax, ebx, ecx, edx);
+  return (edx & CPUID_PDPE1GB) != 0;
+}
+
+/**
+ * @internal
+ * Return whether the page tables with top-level table at physical address
+ * TOP map the page at virtual address VA to physical address PA, with
+ * write access.  VA57 says whether the tables are for 5-level paging.  The
+ * tables must be reachable at their identity addresses.
+ */
+static bool
+__early_paging_maps (uint64_t top, bool va57, uint64_t va, uint64_t pa)
+{
+  const uint64_t *table = (const uint64_t *) (uintptr_t) (top & PTE_ADDR);
+  unsigned shift = va57 ? 48 : 39;
+  for (;;)
+    {
+      uint64_t pte = table[va >> shift & (PT_ENTRIES - 1)],
+	       span = (uint64_t) 1 << shift;
+      if ((pte & (PTE_P | PTE_W)) != (PTE_P | PTE_W))
+	return false;
+      if (shift == 12 || (shift <= 30 && (pte & PTE_PS) != 0))
+	return (pte & PTE_ADDR & ~(span - 1)) + (va & (span - 1)) == pa;
+      table = (const uint64_t *) (uintptr_t) (pte & PTE_ADDR);
+      shift -= 9;
+    }
+}
+
+/**
+ * @internal
+ * Return whether the page tables PT from stage 1 map the physical memory
+ * [BEGIN, END) both at BANE & at the identity address.
+ */
+static bool
+__early_paging_prebuilt_maps (const struct boot_info_page_tables *pt,
+			      bool va57, uint64_t begin, uint64_t end)
+{
+  uint64_t pa;
+  for (pa = begin & ~(PAGE_SIZE - 1); pa < end; pa += PAGE_SIZE)
+    if (! __early_paging_maps (pt->cr3, va57, pa, pa)
+	|| ! __early_paging_maps (pt->cr3, va57, BANE + pa, pa))
+      return false;
+  return true;
+}
+
+/**
+ * @internal
+ * Return whether the page tables PT from stage 1 map RAM up to at least
+ * END, & suit the current paging depth.  Also check that they map the
+ * stage 2 image & the current stack at both BANE & the identity address,
+ * since _start still needs these just after it loads %cr3.
+ */
+static bool
+__early_paging_prebuilt_ok (const struct boot_info_page_tables *pt,
+			    uint64_t end)
+{
+  bool va57 = (__read_cr4 () & CR4_VA57) != 0;
+  uint64_t sp = __early_paging_phys (__builtin_frame_address (0));
+  return pt->cr3 != 0
+	 && (pt->cr3 & ~PTE_ADDR & ~(uint64_t) (PTE_PWT | PTE_PCD)) == 0
+	 && pt->direct_map_end >= end
+	 && pt->direct_map_end <= PML4E_SPAN * (PT_ENTRIES / 2)
+	 && ((pt->flags & BOOT_PT_VA57) != 0) == va57
+	 && __early_paging_prebuilt_maps (pt, va57,
+					  __early_paging_phys (__ehdr_start),
+					  __early_paging_phys (_end))
+	 && __early_paging_prebuilt_maps (pt, va57, sp, sp + PAGE_SIZE);
+}
+
+/**
+ * @internal
+ * Return whether memory of type TYPE is RAM, & so goes in the direct map.
+ */
+static bool
+__early_paging_is_ram (uint32_t type)
+{
+  switch (type)
+    {
+    case EFI_LOADER_CODE:
+    case EFI_LOADER_DATA:
+    case EFI_BOOT_SERVICES_CODE:
+    case EFI_BOOT_SERVICES_DATA:
+    case EFI_RUNTIME_SERVICES_CODE:
+    case EFI_RUNTIME_SERVICES_DATA:
+    case EFI_CONVENTIAL_MEMORY:
+    case EFI_ACPI_RECLAIM_MEMORY:
+    case EFI_ACPI_MEMORY_NVS:
+    case EFI_PERSISTENT_MEMORY:
+      return true;
+    default:
+      return false;
+    }
+}
+
+/** State for building the direct map. */
+struct early_paging
+{
+  const struct stage1 *stage1;
+  uint64_t *pml4, text, rodata_end;
+  bool has_1g;
+};
+
+/**
+ * @internal
+ * Return the page table which the page table entry at PTE points to,
+ * creating it if it does not exist yet.  Return NULL if there is no memory.
+ */
+static uint64_t *
+__early_paging_next (const struct early_paging *pg, uint64_t *pte)
+{
+  uint64_t *table;
+  if ((*pte & PTE_P) != 0)
+    return (uint64_t *) (uintptr_t) (*pte & PTE_ADDR);
+  table = __early_paging_table (pg->stage1);
+  if (table)
+    *pte = (uintptr_t) table | PTE_P | PTE_W;
+  return table;
+}
+
+/**
+ * @internal
+ * Return whether a page of SIZE bytes at PA fits inside [PA, END), & does
+ * not straddle either end of the stage 2 text & read-only data.
+ */
+static bool
+__early_paging_fits (const struct early_paging *pg, uint64_t pa,
+		     uint64_t size, uint64_t end)
+{
+  return pa % size == 0 && size <= end - pa
+	 && ! (pa < pg->text && pg->text < pa + size)
+	 && ! (pa < pg->rodata_end && pg->rodata_end < pa + size);
+}
+
+/**
+ * @internal
+ * Return the page table entry for a page of SIZE bytes at PA.  Only pages
+ * which lie wholly inside the stage 2 text & read-only data are global.
+ */
+static uint64_t
+__early_paging_pte (const struct early_paging *pg, uint64_t pa,
+		    uint64_t size)
+{
+  uint64_t pte = pa | PTE_P | PTE_W;
+  if (size != PAGE_SIZE)
+    pte |= PTE_PS;
+  if (pg->text <= pa && pa + size <= pg->rodata_end)
+    pte |= PTE_G;
+  return pte;
+}
+
+/**
+ * @internal
+ * Map the physical memory [PA, END) at BANE, using the largest pages which
+ * fit.  Skip any part which is already mapped by a large page.  Return
+ * false if there is no memory.
+ */
+static bool
+__early_paging_map (const struct early_paging *pg, uint64_t pa,
+		    uint64_t end)
+{
+  while (pa < end)
+    {
+      uint64_t *pdpt, *pd, *pt, *pte, size = PAGE_1G;
+      pdpt = __early_paging_next (pg, &pg->pml4[PT_ENTRIES / 2
+						+ pa / PML4E_SPAN]);
+      if (! pdpt)
+	return false;
+      pte = &pdpt[pa / PAGE_1G % PT_ENTRIES];
+      if ((*pte & (PTE_P | PTE_PS)) != (PTE_P | PTE_PS)
+	  && (! pg->has_1g || *pte != 0
+	      || ! __early_paging_fits (pg, pa, size, end)))
+	{
+	  pd = __early_paging_next (pg, pte);
+	  if (! pd)
+	    return false;
+	  size = PAGE_2M;
+	  pte = &pd[pa / PAGE_2M % PT_ENTRIES];
+	  if ((*pte & (PTE_P | PTE_PS)) != (PTE_P | PTE_PS)
+	      && (*pte != 0 || ! __early_paging_fits (pg, pa, size, end)))
+	    {
+	      pt = __early_paging_next (pg, pte);
+	      if (! pt)
+		return false;
+	      size = PAGE_SIZE;
+	      pte = &pt[pa / PAGE_SIZE % PT_ENTRIES];
+	    }
+	}
+      if (! *pte)
+	*pte = __early_paging_pte (pg, pa, size);
+      pa = (pa & ~(size - 1)) + size;
+    }
+  return true;
+}
+
+/**
+ * @internal
+ * Return whether descriptor DESC in STAGE1's memory map is RAM which
+ * directly follows some other RAM descriptor.
+ */
+static bool
+__early_paging_follows_ram (const struct stage1 *stage1,
+			    const struct efi_memory_descriptor *desc)
+{
+  size_t i, n = __mem_map_descs (stage1);
+  for (i = 0; i < n; ++i)
+    {
+      const struct efi_memory_descriptor *prev = __mem_map_desc (stage1, i);
+      if (__early_paging_is_ram (prev->type) && prev->pages != 0
+	  && prev->physical_start + prev->pages * PAGE_SIZE
+	     == desc->physical_start)
+	return true;
+    }
+  return false;
+}
+
+/**
+ * @internal
+ * Return the end of the run of RAM descriptors in STAGE1's memory map which
+ * starts at END, or END if there is none.
+ */
+static uint64_t
+__early_paging_ram_run (const struct stage1 *stage1, uint64_t end)
+{
+  size_t i, n = __mem_map_descs (stage1);
+  bool more = true;
+  while (more)
+    {
+      more = false;
+      for (i = 0; i < n; ++i)
+	{
+	  const struct efi_memory_descriptor *desc
+	    = __mem_map_desc (stage1, i);
+	  if (__early_paging_is_ram (desc->type) && desc->pages != 0
+	      && desc->physical_start == end)
+	    {
+	      end += desc->pages * PAGE_SIZE;
+	      more = true;
+	    }
+	}
+    }
+  return end;
+}
+
+/**
+ * Build page tables which map all the RAM in STAGE1's memory map, & only
+ * RAM, both at BANE & at the identity address, or use the tables which
+ * stage 1 built if they do this.  Return the value to load into %cr3, or 0
+ * if there is not enough memory.  This should be called under the
+ * firmware's identity mapping, with STAGE1's pointers still pointing to low
+ * memory.
+ */
+uint64_t
+__early_init_paging (const struct stage1 *stage1)
+{
+  uint64_t end = 0, *top;
+  struct early_paging pg;
+  size_t i, n = __mem_map_descs (stage1);
+  for (i = 0; i < n; ++i)
+    {
+      const struct efi_memory_descriptor *desc = __mem_map_desc (stage1, i);
+      uint64_t desc_end = desc->physical_start + desc->pages * PAGE_SIZE;
+      if (__early_paging_is_ram (desc->type) && desc_end > end)
+	end = desc_end;
+    }
+  if (end > PML4E_SPAN * (PT_ENTRIES / 2))
+    end = PML4E_SPAN * (PT_ENTRIES / 2);
+  if (stage1->page_tables
+      && __early_paging_prebuilt_ok (stage1->page_tables, end))
+    {
+      __direct_map_end = stage1->page_tables->direct_map_end;
+      return stage1->page_tables->cr3;
+    }
+  pg.stage1 = stage1;
+  pg.text = __early_paging_phys (__ehdr_start);
+  pg.rodata_end = __early_paging_phys (_erodata);
+  pg.has_1g = __early_paging_has_1g ();
+  pg.pml4 = __early_paging_table (stage1);
+  if (! pg.pml4)
+    return 0;
+  /*
+   * Map each run of adjacent RAM descriptors in one go, so that large
+   * pages can span descriptor boundaries.  Memory-mapped I/O stays out of
+   * the direct map; __mmio_map (.) maps it with the right memory type.
+   */
+  for (i = 0; i < n; ++i)
+    {
+      const struct efi_memory_descriptor *desc = __mem_map_desc (stage1, i);
+      uint64_t run_end;
+      if (! __early_paging_is_ram (desc->type) || desc->pages == 0
+	  || desc->physical_start >= end
+	  || __early_paging_follows_ram (stage1, desc))
+	continue;
+      run_end = __early_paging_ram_run (stage1, desc->physical_start);
+      if (run_end > end)
+	run_end = end;
+      if (! __early_paging_map (&pg, desc->physical_start, run_end))
+	return 0;
+    }
+  __direct_map_end = end;
+  memcpy (pg.pml4, pg.pml4 + PT_ENTRIES / 2, PAGE_SIZE / 2);
+  /*
+   * Under 5-level paging, BANE is in the last PML5 entry, & the identity
+   * mapping in the first.  Both can share the same PML4 table.
+   */
+  top = pg.pml4;
+  if ((__read_cr4 () & CR4_VA57) != 0)
+    {
+      top = __early_paging_table (stage1);
+      if (! top)
+	return 0;
+      top[0] = top[PT_ENTRIES - 1] = (uintptr_t) pg.pml4 | PTE_P | PTE_W;
+    }
+  return (uintptr_t) top;
+}
+
+/**
+ * Return a pointer to the PML4 table which maps the upper half of the
+ * virtual address space.
+ */
+uint64_t *
+__paging_pml4 (void)
+{
+  uint64_t *top = __early_map_memory (__read_cr3 () & PTE_ADDR, PAGE_SIZE);
+  if ((__read_cr4 () & CR4_VA57) != 0)
+    return __early_map_memory (top[PT_ENTRIES - 1] & PTE_ADDR, PAGE_SIZE);
+  return top;
+}
+
+/**
+ * Remove the identity mapping from the page tables built by
+ * __early_init_paging (.), once we are running at BANE, set up the PAT, &
+ * turn on global pages.  Turning on %cr4.PGE also flushes the whole TLB, so
+ * no stale identity mappings or memory types are left behind.
+ */
+void
+__early_finish_paging (void)
+{
+  uint64_t cr4 = __read_cr4 (),
+	   *top = __early_map_memory (__read_cr3 () & PTE_ADDR, PAGE_SIZE);
+  if ((cr4 & CR4_VA57) != 0)
+    memset (top, 0, PAGE_SIZE / 2);
+  memset (__paging_pml4 (), 0, PAGE_SIZE / 2);
+  __early_init_pat ();
+  __write_cr4 (cr4 | CR4_PGE);
+}
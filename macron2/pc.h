@@ -9,19 +9,163 @@
 #ifndef _H_MACRON2_PC
 #define _H_MACRON2_PC
 
-#define CR0_WP		(1 << 16)
+#define CR4_PGE		(1 << 7)
 #define CR4_VA57	(1 << 12)
 
+#define PTE_P		(1 << 0)
+#define PTE_W		(1 << 1)
+#define PTE_PWT		(1 << 3)
+#define PTE_PCD		(1 << 4)
+#define PTE_PS		(1 << 7)
+#define PTE_G		(1 << 8)
+#define PTE_ADDR	0x000ffffffffff000
+
+#define MSR_PAT		0x277
+
+/** CPUID 1 %ecx bit: we are running under a hypervisor. */
+#define CPUID_HYPERVISOR	(1U << 31)
+
 #define BANE		0xffff800000000000
 
+/** Maximum number of processors which may run stage 2. */
+#define MAX_CPUS	1
+
 #ifndef __ASSEMBLER__
+# include <cpuid.h>
+# include <stdbool.h>
 # include <stddef.h>
 # include <stdint.h>
+/**
+ * Return a pointer to the physical memory at __WHERE in the direct map.
+ * This is meant for RAM; device memory should be mapped with
+ * __mmio_map (.) instead.
+ */
 static inline void *
 __early_map_memory (uintptr_t __where, size_t __length)
 {
   return (void *) (BANE + __where);
 }
+
+static inline uint8_t
+__inb (uint16_t __port)
+{
+  uint8_t __v;
+  __asm volatile ("inb %1, %0" : "=a" (__v) : "Nd" (__port));
+  return __v;
+}
+
+static inline void
+__outb (uint16_t __port, uint8_t __v)
+{
+  __asm volatile ("outb %0, %1" : : "a" (__v), "Nd" (__port));
+}
+
+static inline void
+__outw (uint16_t __port, uint16_t __v)
+{
+  __asm volatile ("outw %0, %1" : : "a" (__v), "Nd" (__port));
+}
+
+/**
+ * Return the index of the processor we are running on, for indexing
+ * per-processor data.  For now only the bootstrap processor ever runs
+ * stage 2.
+ */
+static inline unsigned
+__this_cpu (void)
+{
+  return 0;
+}
+
+/** Return whether we are running under a hypervisor. */
+static inline bool
+__under_hypervisor (void)
+{
+  unsigned __eax, __ebx, __ecx, __edx;
+  if (! __get_cpuid (1, &__eax, &__ebx, &__ecx, &__edx))
+    return false;
+  return (__ecx & CPUID_HYPERVISOR) != 0;
+}
+
+static inline void
+__pause (void)
+{
+  __asm volatile ("pause");
+}
+
+static inline uint64_t
+__read_cr3 (void)
+{
+  uint64_t __v;
+  __asm volatile ("mov %%cr3, %0" : "=r" (__v));
+  return __v;
+}
+
+static inline uint64_t
+__read_cr4 (void)
+{
+  uint64_t __v;
+  __asm volatile ("mov %%cr4, %0" : "=r" (__v));
+  return __v;
+}
+
+static inline void
+__write_cr4 (uint64_t __v)
+{
+  __asm volatile ("mov %0, %%cr4" : : "r" (__v) : "memory");
+}
+
+/** Base & limit of a descriptor table, as stored by sgdt or sidt. */
+struct pc_desc_table
+{
+  uint16_t limit;
+  uint64_t base;
+} __attribute__ ((packed));
+
+static inline struct pc_desc_table
+__sgdt (void)
+{
+  struct pc_desc_table __t;
+  __asm volatile ("sgdt %0" : "=m" (__t));
+  return __t;
+}
+
+static inline struct pc_desc_table
+__sidt (void)
+{
+  struct pc_desc_table __t;
+  __asm volatile ("sidt %0" : "=m" (__t));
+  return __t;
+}
+
+static inline uint64_t
+__rdmsr (uint32_t __msr)
+{
+  uint32_t __lo, __hi;
+  __asm volatile ("rdmsr" : "=a" (__lo), "=d" (__hi) : "c" (__msr));
+  return (uint64_t) __hi << 32 | __lo;
+}
+
+static inline void
+__wrmsr (uint32_t __msr, uint64_t __v)
+{
+  __asm volatile ("wrmsr" : : "c" (__msr), "a" ((uint32_t) __v),
+				"d" ((uint32_t) (__v >> 32)) : "memory");
+}
+
+static inline void
+__wbinvd (void)
+{
+  __asm volatile ("wbinvd" : : : "memory");
+}
+
+static inline uint64_t
+__read_tsc (void)
+{
+  uint32_t __lo, __hi;
+  __asm volatile ("rdtsc" : "=a" (__lo), "=d" (__hi));
+  return (uint64_t) __hi << 32 | __lo;
+}
 #endif  /* ! __ASSEMBLER__ */
 
 #endif
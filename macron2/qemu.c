@@ -0,0 +1,102 @@
+/*
+ * Copyright (c) 2023 TK Chia
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+/**
+ * @internal
+ * @fileoverview Hooks for running under QEMU.
+ *
+ * QEMU's fw_cfg device lets the host pass named files to the guest.  We use
+ * it to tell stage 2, at run time, that it is being benchmarked, & should
+ * exit QEMU once it has booted.  We only probe for fw_cfg if CPUID says
+ * that we are under a hypervisor, so that on real hardware we do no I/O
+ * to ports which may belong to some unknown device.  Under a hypervisor
+ * other than QEMU, the fw_cfg signature will not read back as "QEMU", &
+ * the hooks do nothing.
+ */
+
+#include <string.h>
+#include "klog.h"
+#include "pc.h"
+#include "qemu.h"
+#include "serial.h"
+
+enum
+{
+  FW_CFG_SEL = 0x510,
+  FW_CFG_DATA = 0x511,
+  FW_CFG_SIGNATURE = 0x0000,
+  FW_CFG_FILE_DIR = 0x0019
+};
+
+/** Entry in the fw_cfg file directory.  Numbers are big-endian. */
+struct fw_cfg_file
+{
+  uint8_t size[4];
+  uint8_t select[2];
+  uint8_t reserved[2];
+  char name[56];
+};
+
+static void
+__qemu_fw_cfg_read (void *buf, size_t n)
+{
+  uint8_t *p = buf;
+  while (n-- != 0)
+    *p++ = __inb (FW_CFG_DATA);
+}
+
+static bool
+__qemu_fw_cfg_present (void)
+{
+  char sig[4];
+  if (! __under_hypervisor ())
+    return false;
+  __outw (FW_CFG_SEL, FW_CFG_SIGNATURE);
+  __qemu_fw_cfg_read (sig, sizeof sig);
+  return memcmp (sig, "QEMU", sizeof sig) == 0;
+}
+
+/**
+ * Return whether QEMU's fw_cfg device is present & has a file named NAME.
+ */
+bool
+__qemu_fw_cfg_find (const char *name)
+{
+  uint8_t count[4];
+  uint32_t n;
+  struct fw_cfg_file f;
+  if (! __qemu_fw_cfg_present ())
+    return false;
+  __outw (FW_CFG_SEL, FW_CFG_FILE_DIR);
+  __qemu_fw_cfg_read (count, sizeof count);
+  n = (uint32_t) count[0] << 24 | (uint32_t) count[1] << 16
+      | (uint32_t) count[2] << 8 | count[3];
+  while (n-- != 0)
+    {
+      __qemu_fw_cfg_read (&f, sizeof f);
+      if (strncmp (f.name, name, sizeof f.name) == 0)
+	return true;
+    }
+  return false;
+}
+
+/**
+ * If the host asked for it through QEMU_EXIT_FILE, send out any pending
+ * kernel log output, then exit QEMU through the isa-debug-exit device.
+ * QEMU then exits with status 1.
+ */
+void
+__qemu_exit_if_asked (void)
+{
+  if (! __qemu_fw_cfg_find (QEMU_EXIT_FILE))
+    return;
+  __klog_puts ("qemu: exiting\n");
+  __klog_flush ();
+  __serial_flush ();
+  __outb (QEMU_DEBUG_EXIT, 0);
+}
@@ -0,0 +1,29 @@
+/*
+ * Copyright (c) 2023 TK Chia
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+/**
+ * @internal Hooks for running under QEMU.
+ */
+
+#ifndef _H_MACRON2_QEMU
+#define _H_MACRON2_QEMU
+
+#include <stdbool.h>
+
+/**
+ * Name of the fw_cfg file which asks stage 2 to exit QEMU, through the
+ * isa-debug-exit device, once it has booted.
+ */
+#define QEMU_EXIT_FILE		"opt/macron2/exit-after-boot"
+/** I/O port of the isa-debug-exit device. */
+#define QEMU_DEBUG_EXIT		0xf4
+
+extern bool __qemu_fw_cfg_find (const char *);
+extern void __qemu_exit_if_asked (void);
+
+#endif
@@ -0,0 +1,172 @@
+/*
+ * Copyright (c) 2023 TK Chia
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+/**
+ * @internal
+ * @fileoverview Buffered output to a 16550-compatible serial port.
+ *
+ * Output is queued in a memory buffer, & moved to the UART's transmit FIFO
+ * by __serial_poll (.) or __serial_flush (.).  Each time the UART says its
+ * transmitter holding register is empty, we know the whole FIFO is free, &
+ * can write up to a FIFO's worth of bytes without checking again.
+ */
+
+#include <string.h>
+#include "pc.h"
+#include "serial.h"
+
+/* UART register offsets. */
+#define UART_THR	0	/* transmit holding register (write) */
+#define UART_DLL	0	/* divisor latch, low byte (DLAB = 1) */
+#define UART_IER	1	/* interrupt enable register */
+#define UART_DLM	1	/* divisor latch, high byte (DLAB = 1) */
+#define UART_IIR	2	/* interrupt identification register (read) */
+#define UART_FCR	2	/* FIFO control register (write) */
+#define UART_LCR	3	/* line control register */
+#define UART_MCR	4	/* modem control register */
+#define UART_LSR	5	/* line status register */
+#define UART_SCR	7	/* scratch register */
+
+#define UART_LCR_8N1	0x03
+#define UART_LCR_DLAB	0x80
+#define UART_MCR_DTR	0x01
+#define UART_MCR_RTS	0x02
+#define UART_MCR_OUT2	0x08
+#define UART_LSR_THRE	0x20
+#define UART_FCR_ENABLE	0x01
+#define UART_FCR_CLEAR	0x06
+#define UART_FCR_TRIG14	0xc0
+#define UART_IIR_FIFO	0xc0
+
+/** Divisor for 115,200 baud. */
+#define UART_DIVISOR	1
+/** Depth of a 16550A transmit FIFO. */
+#define UART_FIFO_SIZE	16
+
+static struct
+  {
+    uint16_t port;
+    /** No. of bytes we may write to the UART after each THRE check. */
+    uint8_t burst;
+    bool present;
+    /** Total bytes ever queued & ever sent. */
+    size_t head, tail;
+    char buf[SERIAL_BUF_SIZE];
+  } __serial;
+
+/**
+ * Set up the serial port at I/O base PORT for output at 115,200 baud, 8N1.
+ * Return true if a UART seems to be there.
+ */
+bool
+__early_init_serial (uint16_t port)
+{
+  __serial.port = port;
+  __serial.head = __serial.tail = 0;
+  /* Check the scratch register to see if there is a UART at all. */
+  __outb (port + UART_SCR, 0x5a);
+  if (__inb (port + UART_SCR) != 0x5a)
+    return __serial.present = false;
+  __outb (port + UART_IER, 0);
+  __outb (port + UART_LCR, UART_LCR_DLAB);
+  __outb (port + UART_DLL, UART_DIVISOR & 0xff);
+  __outb (port + UART_DLM, UART_DIVISOR >> 8);
+  __outb (port + UART_LCR, UART_LCR_8N1);
+  __outb (port + UART_FCR, UART_FCR_ENABLE | UART_FCR_CLEAR
+			   | UART_FCR_TRIG14);
+  __outb (port + UART_MCR, UART_MCR_DTR | UART_MCR_RTS | UART_MCR_OUT2);
+  /* Only use bursts if the UART reports a working FIFO. */
+  if ((__inb (port + UART_IIR) & UART_IIR_FIFO) == UART_IIR_FIFO)
+    __serial.burst = UART_FIFO_SIZE;
+  else
+    __serial.burst = 1;
+  return __serial.present = true;
+}
+
+bool
+__serial_present (void)
+{
+  return __serial.present;
+}
+
+/**
+ * If the UART's transmitter is ready, move up to a FIFO's worth of queued
+ * output to it.  Return true if there is still output queued.
+ */
+static bool
+__serial_push (void)
+{
+  uint16_t port = __serial.port;
+  size_t tail = __serial.tail, n = __serial.head - tail;
+  if (! n)
+    return false;
+  if ((__inb (port + UART_LSR) & UART_LSR_THRE) == 0)
+    return true;
+  if (n > __serial.burst)
+    n = __serial.burst;
+  while (n-- != 0)
+    {
+      __outb (port + UART_THR, __serial.buf[tail & (SERIAL_BUF_SIZE - 1)]);
+      ++tail;
+    }
+  __serial.tail = tail;
+  return __serial.head != tail;
+}
+
+static void
+__serial_putc (char c)
+{
+  while (__serial.head - __serial.tail >= SERIAL_BUF_SIZE)
+    {
+      __serial_push ();
+      __pause ();
+    }
+  __serial.buf[__serial.head & (SERIAL_BUF_SIZE - 1)] = c;
+  ++__serial.head;
+}
+
+/**
+ * Queue N bytes at DATA for output, translating each LF into CR LF.  This
+ * only waits for the UART if the output buffer is full.
+ */
+void
+__serial_write (const void *data, size_t n)
+{
+  const char *p = data;
+  if (! __serial.present)
+    return;
+  while (n-- != 0)
+    {
+      char c = *p++;
+      if (c == '\n')
+	__serial_putc ('\r');
+      __serial_putc (c);
+    }
+}
+
+/**
+ * Move some queued output to the UART if it is ready, without waiting.
+ */
+void
+__serial_poll (void)
+{
+  if (__serial.present)
+    __serial_push ();
+}
+
+/**
+ * Wait until all queued output has been handed to the UART.
+ */
+void
+__serial_flush (void)
+{
+  if (! __serial.present)
+    return;
+  while (__serial_push ())
+    __pause ();
+}
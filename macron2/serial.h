@@ -0,0 +1,31 @@
+/*
+ * Copyright (c) 2023 TK Chia
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+/**
+ * @internal Output to a 16550-compatible serial port.
+ */
+
+#ifndef _H_MACRON2_SERIAL
+#define _H_MACRON2_SERIAL
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/** I/O port base of the first serial port, COM1. */
+#define SERIAL_COM1	0x3f8
+/** Size of the serial output buffer, in bytes.  Must be a power of 2. */
+#define SERIAL_BUF_SIZE	0x1000
+
+extern bool __early_init_serial (uint16_t);
+extern bool __serial_present (void);
+extern void __serial_write (const void *, size_t);
+extern void __serial_poll (void);
+extern void __serial_flush (void);
+
+#endif
@@ -0,0 +1,408 @@
+/*
+ * Copyright (c) 2023 TK Chia
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+/**
+ * @internal
+ * @fileoverview Slab allocator for kernel objects.
+ *
+ * Objects of up to SLAB_MAX_SIZE bytes are rounded up to one of
+ * SLAB_CLASSES size classes, & carved out of slabs of 2 ** SLAB_ORDER
+ * pages from the page allocator.  Each slab is aligned to its size, &
+ * starts with a header, so that the slab which holds an object can be
+ * found by just masking the object's address.  A slab keeps its own list
+ * of free objects, plus a pointer to the part of it which has never been
+ * handed out, so that a new slab needs no setting up.  Slabs which have
+ * free objects are kept on a list for their size class.
+ *
+ * On top of this, each processor keeps its own list of free objects for
+ * each size class, which it can allocate from & free to without taking
+ * any locks.  It takes the size class's lock only to move SLAB_CPU_BATCH
+ * objects at a time to or from the slabs.
+ *
+ * Larger objects come straight from the page allocator, in blocks of at
+ * least 2 ** SLAB_ORDER pages, which also start with a header.
+ */
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <string.h>
+#include "page.h"
+#include "pc.h"
+#include "slab.h"
+
+#define SLAB_BYTES	((size_t) PAGE_SIZE << SLAB_ORDER)
+/** Space taken by the header at the start of each slab. */
+#define SLAB_HDR_SIZE	64
+/** Alignment of all objects. */
+#define SLAB_MIN_ALIGN	16
+/** Size class number which marks a block from the page allocator. */
+#define SLAB_LARGE	SLAB_CLASSES
+
+struct slab
+{
+  unsigned cls, order;
+  /** Number of objects handed out from this slab. */
+  size_t inuse;
+  /** Free objects in this slab. */
+  void *free;
+  /** Start of the part of this slab which was never handed out. */
+  char *fresh;
+  /** Links in the list of slabs with free objects. */
+  struct slab *next, *prev;
+};
+
+_Static_assert (sizeof (struct slab) <= SLAB_HDR_SIZE,
+		"SLAB_HDR_SIZE too small");
+_Static_assert (SLAB_HDR_SIZE % SLAB_MIN_ALIGN == 0,
+		"SLAB_HDR_SIZE should be a multiple of SLAB_MIN_ALIGN");
+
+struct slab_class
+{
+  atomic_flag lock;
+  size_t slabs;
+  struct slab *partial;
+};
+
+struct slab_cpu
+{
+  void *free[SLAB_CLASSES];
+  unsigned n[SLAB_CLASSES];
+  uint64_t allocs[SLAB_CLASSES], frees[SLAB_CLASSES];
+};
+
+static const uint16_t __slab_sizes[SLAB_CLASSES] =
+  { 16, 32, 48, 64, 96, 128, 192, 256, 384, 512, 768, 1024, 1536, 2048 };
+
+_Static_assert (SLAB_MAX_SIZE == 2048,
+		"SLAB_MAX_SIZE should match the last size class");
+
+static struct slab_class __slab_classes[SLAB_CLASSES];
+static struct slab_cpu __slab_cpus[MAX_CPUS];
+
+static struct
+  {
+    _Atomic uint64_t blocks, pages, allocs, frees;
+  } __slab_large;
+
+static void
+__slab_lock (struct slab_class *c)
+{
+  while (atomic_flag_test_and_set_explicit (&c->lock, memory_order_acquire))
+    __pause ();
+}
+
+static void
+__slab_unlock (struct slab_class *c)
+{
+  atomic_flag_clear_explicit (&c->lock, memory_order_release);
+}
+
+static struct slab *
+__slab_of (const void *p)
+{
+  return (struct slab *) ((uintptr_t) p & ~(uintptr_t) (SLAB_BYTES - 1));
+}
+
+static unsigned
+__slab_class (size_t size)
+{
+  unsigned cls = 0;
+  while (__slab_sizes[cls] < size)
+    ++cls;
+  return cls;
+}
+
+static bool
+__slab_full (const struct slab *s)
+{
+  return ! s->free
+	 && s->fresh + __slab_sizes[s->cls] > (const char *) s + SLAB_BYTES;
+}
+
+static void
+__slab_list_add (struct slab_class *c, struct slab *s)
+{
+  s->prev = NULL;
+  s->next = c->partial;
+  if (s->next)
+    s->next->prev = s;
+  c->partial = s;
+}
+
+static void
+__slab_list_del (struct slab_class *c, struct slab *s)
+{
+  if (s->prev)
+    s->prev->next = s->next;
+  else
+    c->partial = s->next;
+  if (s->next)
+    s->next->prev = s->prev;
+}
+
+/**
+ * @internal
+ * Take a free object of size class CLS from the slabs, getting a new slab
+ * if need be.  Return NULL if there is no memory.  The caller should hold
+ * the size class's lock.
+ */
+static void *
+__slab_take (unsigned cls)
+{
+  struct slab_class *c = &__slab_classes[cls];
+  struct slab *s = c->partial;
+  void *obj;
+  if (! s)
+    {
+      s = __page_alloc (SLAB_ORDER);
+      if (! s)
+	return NULL;
+      s->cls = cls;
+      s->order = SLAB_ORDER;
+      s->inuse = 0;
+      s->free = NULL;
+      s->fresh = (char *) s + SLAB_HDR_SIZE;
+      __slab_list_add (c, s);
+      ++c->slabs;
+    }
+  if (s->free)
+    {
+      obj = s->free;
+      s->free = *(void **) obj;
+    }
+  else
+    {
+      obj = s->fresh;
+      s->fresh += __slab_sizes[cls];
+    }
+  ++s->inuse;
+  if (__slab_full (s))
+    __slab_list_del (c, s);
+  return obj;
+}
+
+/**
+ * @internal
+ * Give the object OBJ of size class CLS back to its slab, & give the slab
+ * back to the page allocator if it is now empty, unless it is the only one
+ * left with free objects.  The caller should hold the size class's lock.
+ */
+static void
+__slab_give (unsigned cls, void *obj)
+{
+  struct slab_class *c = &__slab_classes[cls];
+  struct slab *s = __slab_of (obj);
+  bool was_full = __slab_full (s);
+  *(void **) obj = s->free;
+  s->free = obj;
+  --s->inuse;
+  if (was_full)
+    __slab_list_add (c, s);
+  if (s->inuse == 0 && (c->partial != s || s->next))
+    {
+      __slab_list_del (c, s);
+      --c->slabs;
+      __page_free (s, SLAB_ORDER);
+    }
+}
+
+static void
+__slab_refill (struct slab_cpu *cpu, unsigned cls)
+{
+  struct slab_class *c = &__slab_classes[cls];
+  unsigned i;
+  __slab_lock (c);
+  for (i = 0; i < SLAB_CPU_BATCH; ++i)
+    {
+      void *obj = __slab_take (cls);
+      if (! obj)
+	break;
+      *(void **) obj = cpu->free[cls];
+      cpu->free[cls] = obj;
+      ++cpu->n[cls];
+    }
+  __slab_unlock (c);
+}
+
+static void
+__slab_drain (struct slab_cpu *cpu, unsigned cls)
+{
+  struct slab_class *c = &__slab_classes[cls];
+  unsigned i;
+  __slab_lock (c);
+  for (i = 0; i < SLAB_CPU_BATCH; ++i)
+    {
+      void *obj = cpu->free[cls];
+      cpu->free[cls] = *(void **) obj;
+      --cpu->n[cls];
+      __slab_give (cls, obj);
+    }
+  __slab_unlock (c);
+}
+
+static void *
+__slab_alloc_class (unsigned cls)
+{
+  struct slab_cpu *cpu = &__slab_cpus[__this_cpu ()];
+  void *obj;
+  if (! cpu->free[cls])
+    {
+      __slab_refill (cpu, cls);
+      if (! cpu->free[cls])
+	return NULL;
+    }
+  obj = cpu->free[cls];
+  cpu->free[cls] = *(void **) obj;
+  --cpu->n[cls];
+  ++cpu->allocs[cls];
+  return obj;
+}
+
+/**
+ * @internal
+ * Allocate SIZE bytes straight from the page allocator, starting OFF bytes
+ * into the block.  OFF should be at least SLAB_HDR_SIZE & at most
+ * PAGE_SIZE.
+ */
+static void *
+__slab_alloc_large (size_t size, size_t off)
+{
+  unsigned order = SLAB_ORDER;
+  struct slab *s;
+  if (size > ((size_t) PAGE_SIZE << PAGE_MAX_ORDER) - off)
+    return NULL;
+  while (((size_t) PAGE_SIZE << order) - off < size)
+    ++order;
+  s = __page_alloc (order);
+  if (! s)
+    return NULL;
+  s->cls = SLAB_LARGE;
+  s->order = order;
+  atomic_fetch_add_explicit (&__slab_large.blocks, 1, memory_order_relaxed);
+  atomic_fetch_add_explicit (&__slab_large.pages, (uint64_t) 1 << order,
+			     memory_order_relaxed);
+  atomic_fetch_add_explicit (&__slab_large.allocs, 1, memory_order_relaxed);
+  return (char *) s + off;
+}
+
+/**
+ * Allocate an object of SIZE bytes, aligned to at least 16 bytes.  Return
+ * NULL if there is no memory.
+ */
+void *
+__slab_alloc (size_t size)
+{
+  if (size > SLAB_MAX_SIZE)
+    return __slab_alloc_large (size, SLAB_HDR_SIZE);
+  return __slab_alloc_class (__slab_class (size));
+}
+
+/**
+ * Allocate an object of SIZE bytes, aligned to ALIGN bytes, which should be
+ * a power of 2.  Return NULL if there is no memory, or if ALIGN is more
+ * than PAGE_SIZE.
+ */
+void *
+__slab_alloc_aligned (size_t align, size_t size)
+{
+  unsigned cls;
+  if (align <= SLAB_MIN_ALIGN)
+    return __slab_alloc (size);
+  if (align > PAGE_SIZE || (align & (align - 1)) != 0)
+    return NULL;
+  /*
+   * Objects of a size class sit at SLAB_HDR_SIZE plus multiples of the
+   * class's size from the start of a slab.  So a size class will do if
+   * ALIGN divides both of these.
+   */
+  if (align <= SLAB_HDR_SIZE && size <= SLAB_MAX_SIZE)
+    for (cls = __slab_class (size); cls < SLAB_CLASSES; ++cls)
+      if (__slab_sizes[cls] % align == 0)
+	return __slab_alloc_class (cls);
+  return __slab_alloc_large (size, align < SLAB_HDR_SIZE ? SLAB_HDR_SIZE
+							 : align);
+}
+
+/**
+ * Free the object at P, which should have come from __slab_alloc (.) or
+ * __slab_alloc_aligned (.).
+ */
+void
+__slab_free (void *p)
+{
+  struct slab *s;
+  struct slab_cpu *cpu;
+  unsigned cls;
+  if (! p)
+    return;
+  s = __slab_of (p);
+  cls = s->cls;
+  if (cls == SLAB_LARGE)
+    {
+      atomic_fetch_sub_explicit (&__slab_large.blocks, 1,
+				 memory_order_relaxed);
+      atomic_fetch_sub_explicit (&__slab_large.pages,
+				 (uint64_t) 1 << s->order,
+				 memory_order_relaxed);
+      atomic_fetch_add_explicit (&__slab_large.frees, 1,
+				 memory_order_relaxed);
+      __page_free (s, s->order);
+      return;
+    }
+  cpu = &__slab_cpus[__this_cpu ()];
+  *(void **) p = cpu->free[cls];
+  cpu->free[cls] = p;
+  ++cpu->frees[cls];
+  if (++cpu->n[cls] > 2 * SLAB_CPU_BATCH)
+    __slab_drain (cpu, cls);
+}
+
+/**
+ * Return the number of bytes which can actually be used in the object at
+ * P.
+ */
+size_t
+__slab_size (const void *p)
+{
+  const struct slab *s = __slab_of (p);
+  if (s->cls == SLAB_LARGE)
+    return ((size_t) PAGE_SIZE << s->order) - ((const char *) p
+					       - (const char *) s);
+  return __slab_sizes[s->cls];
+}
+
+/**
+ * Fill in STATS with the slab allocator's current statistics.
+ */
+void
+__slab_get_stats (struct slab_stats *stats)
+{
+  unsigned cls, cpu;
+  memset (stats, 0, sizeof (*stats));
+  for (cls = 0; cls < SLAB_CLASSES; ++cls)
+    {
+      struct slab_class *c = &__slab_classes[cls];
+      stats->cls[cls].size = __slab_sizes[cls];
+      __slab_lock (c);
+      stats->cls[cls].slabs = c->slabs;
+      __slab_unlock (c);
+      for (cpu = 0; cpu < MAX_CPUS; ++cpu)
+	{
+	  stats->cls[cls].allocs += __slab_cpus[cpu].allocs[cls];
+	  stats->cls[cls].frees += __slab_cpus[cpu].frees[cls];
+	}
+    }
+  stats->large_blocks = atomic_load_explicit (&__slab_large.blocks,
+					      memory_order_relaxed);
+  stats->large_pages = atomic_load_explicit (&__slab_large.pages,
+					     memory_order_relaxed);
+  stats->large_allocs = atomic_load_explicit (&__slab_large.allocs,
+					      memory_order_relaxed);
+  stats->large_frees = atomic_load_explicit (&__slab_large.frees,
+					     memory_order_relaxed);
+}
@@ -0,0 +1,55 @@
+/*
+ * Copyright (c) 2023 TK Chia
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+/**
+ * @internal Slab allocator for kernel objects.
+ */
+
+#ifndef _H_MACRON2_SLAB
+#define _H_MACRON2_SLAB
+
+#include <stddef.h>
+#include <stdint.h>
+
+/** Each slab is 2 ** this pages. */
+#define SLAB_ORDER	2
+/** Number of object size classes. */
+#define SLAB_CLASSES	14
+/** Largest object size which is allocated from slabs. */
+#define SLAB_MAX_SIZE	2048
+/**
+ * Number of objects which a processor moves between its own free list for
+ * a size class & the slabs at one go.
+ */
+#define SLAB_CPU_BATCH	16
+
+/** Slab allocator statistics. */
+struct slab_stats
+{
+  struct
+    {
+      /** Object size for this class. */
+      size_t size;
+      /** Number of slabs for this class. */
+      size_t slabs;
+      /** Number of objects ever allocated & freed. */
+      uint64_t allocs, frees;
+    } cls[SLAB_CLASSES];
+  /** Number of blocks & pages allocated straight from the page allocator. */
+  uint64_t large_blocks, large_pages;
+  /** Number of such blocks ever allocated & freed. */
+  uint64_t large_allocs, large_frees;
+};
+
+extern void *__slab_alloc (size_t);
+extern void *__slab_alloc_aligned (size_t, size_t);
+extern void __slab_free (void *);
+extern size_t __slab_size (const void *);
+extern void __slab_get_stats (struct slab_stats *);
+
+#endif
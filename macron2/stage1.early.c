@@ -0,0 +1,187 @@
+/*
+ * Copyright (c) 2023 TK Chia
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+/**
+ * @internal
+ * @fileoverview Reading the information passed in by stage 1, in either
+ * the legacy register form or as a struct boot_info block.  See stage1.h.
+ */
+
+#include <stdalign.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <string.h>
+#include "pc.h"
+#include "stage1.h"
+#include "trace.h"
+
+static struct stage1 __stage1;
+
+/*
+ * In the legacy register form, the begin & end fields of each
+ * struct boot_reserve are laid out just like a struct boot_info_range, so
+ * stage 2 can use the caller's list in place.
+ */
+_Static_assert (offsetof (struct boot_reserve, end)
+		- offsetof (struct boot_reserve, begin)
+		== offsetof (struct boot_info_range, end)
+		   - offsetof (struct boot_info_range, begin)
+		&& offsetof (struct boot_info_range, begin) == 0,
+		"struct boot_reserve does not embed a struct boot_info_range");
+
+/**
+ * @internal
+ * Look up tag TAG in INFO, & check that its data fit inside INFO, are at
+ * least MIN_SIZE bytes long, & are aligned to ALIGN bytes.  Return a
+ * pointer to the data & store their size in *SIZE, or return NULL.
+ */
+static const void *
+__early_stage1_tag (const struct boot_info *info, enum boot_tag tag,
+		    size_t min_size, size_t align, size_t *size)
+{
+  const void *p = __boot_info_tag (info, tag, size);
+  uint32_t off;
+  if (! p)
+    return NULL;
+  off = info->tag[tag].offset;
+  if (off > info->size || *size > info->size - off
+      || *size < min_size || off % align != 0)
+    return NULL;
+  return p;
+}
+
+static bool
+__early_stage1_from_info (struct stage1 *stage1,
+			  const struct boot_info *info)
+{
+  const struct boot_info_mem_map *mm;
+  const uint64_t *rsdp;
+  const char *cmdline;
+  size_t size;
+  if (info->version != BOOT_INFO_VERSION
+      || info->size < sizeof (*info) + info->tags * sizeof (info->tag[0]))
+    return false;
+  stage1->info = info;
+  mm = __early_stage1_tag (info, BOOT_TAG_MEM_MAP, sizeof (*mm),
+			   alignof (uint64_t), &size);
+  if (! mm || mm->desc_size < sizeof (struct efi_memory_descriptor))
+    return false;
+  stage1->mem_map = (struct efi_memory_descriptor *) (mm + 1);
+  stage1->mem_map_size = size - sizeof (*mm);
+  stage1->mem_map_desc_size = mm->desc_size;
+  stage1->reserve = __early_stage1_tag (info, BOOT_TAG_RESERVE, 0,
+					alignof (struct boot_info_range),
+					&size);
+  if (stage1->reserve)
+    {
+      stage1->reserves = size / sizeof (struct boot_info_range);
+      stage1->reserve_size = sizeof (struct boot_info_range);
+    }
+  stage1->module = __early_stage1_tag (info, BOOT_TAG_MODULES, 0,
+				       alignof (struct boot_info_range),
+				       &size);
+  if (stage1->module)
+    stage1->modules = size / sizeof (struct boot_info_range);
+  stage1->video = __early_stage1_tag (info, BOOT_TAG_VIDEO,
+				      sizeof (struct boot_video),
+				      alignof (struct boot_video), &size);
+  stage1->page_tables
+    = __early_stage1_tag (info, BOOT_TAG_PAGE_TABLES,
+			  sizeof (struct boot_info_page_tables),
+			  alignof (struct boot_info_page_tables), &size);
+  stage1->trace = __early_stage1_tag (info, BOOT_TAG_TRACE, 0,
+				      alignof (struct boot_trace), &size);
+  if (stage1->trace)
+    stage1->traces = size / sizeof (struct boot_trace);
+  rsdp = __early_stage1_tag (info, BOOT_TAG_RSDP, sizeof (*rsdp),
+			     alignof (uint64_t), &size);
+  if (rsdp)
+    stage1->rsdp = *rsdp;
+  cmdline = __early_stage1_tag (info, BOOT_TAG_CMDLINE, 1, 1, &size);
+  if (cmdline && memchr (cmdline, 0, size))
+    stage1->cmdline = cmdline;
+  return true;
+}
+
+static bool
+__early_stage1_from_regs (struct stage1 *stage1,
+			  const struct boot_reserve *rs, size_t nr,
+			  struct efi_memory_descriptor *mem_map,
+			  efi_uint_t mem_map_size,
+			  efi_uint_t mem_map_desc_size)
+{
+  size_t i;
+  if (mem_map_desc_size < sizeof (struct efi_memory_descriptor))
+    return false;
+  for (i = 0; i < nr; ++i)
+    if (! stage1->video && strcmp (rs[i].name, "video") == 0)
+      stage1->video = (const struct boot_video *) (uintptr_t) rs[i].begin;
+  if (nr)
+    stage1->reserve = (const struct boot_info_range *) &rs[0].begin;
+  stage1->reserves = nr;
+  stage1->reserve_size = sizeof (struct boot_reserve);
+  stage1->mem_map = mem_map;
+  stage1->mem_map_size = mem_map_size;
+  stage1->mem_map_desc_size = mem_map_desc_size;
+  return true;
+}
+
+/**
+ * Read the information which stage 1 passed in the registers %rdi, %rsi,
+ * %rdx, %rcx, & %r8, as ARG0 to ARG4.  Return a pointer to the information
+ * in the form which the rest of stage 2 uses, or NULL if the information is
+ * not valid.  This should be called under the firmware's identity mapping;
+ * the pointers in the result will point to low memory.  Also note the time
+ * at which stage 2 started.
+ */
+struct stage1 *
+__early_init_stage1 (uintptr_t arg0, uintptr_t arg1, uintptr_t arg2,
+		     uintptr_t arg3, uintptr_t arg4)
+{
+  struct stage1 *stage1 = &__stage1;
+  const struct boot_info *info = (const struct boot_info *) arg0;
+  uint64_t tsc = __read_tsc ();
+  bool ok;
+  memset (stage1, 0, sizeof (*stage1));
+  if (info && info->magic == BOOT_INFO_MAGIC)
+    ok = __early_stage1_from_info (stage1, info);
+  else
+    ok = __early_stage1_from_regs (stage1,
+				   (const struct boot_reserve *) arg0, arg1,
+				   (struct efi_memory_descriptor *) arg2,
+				   arg3, arg4);
+  if (! ok)
+    return NULL;
+  __early_trace_stage1 (stage1);
+  __early_trace_at (TRACE_STAGE2_START, tsc);
+  return stage1;
+}
+
+static const void *
+__early_stage1_move (const void *p)
+{
+  return p ? (const char *) p + BANE : NULL;
+}
+
+/**
+ * Make the pointers in STAGE1 point to high virtual memory, once we are
+ * running there.
+ */
+void
+__early_relocate_stage1 (struct stage1 *stage1)
+{
+  stage1->reserve = __early_stage1_move (stage1->reserve);
+  stage1->mem_map = (struct efi_memory_descriptor *)
+		    __early_stage1_move (stage1->mem_map);
+  stage1->video = __early_stage1_move (stage1->video);
+  stage1->cmdline = __early_stage1_move (stage1->cmdline);
+  stage1->module = __early_stage1_move (stage1->module);
+  stage1->trace = __early_stage1_move (stage1->trace);
+  stage1->page_tables = __early_stage1_move (stage1->page_tables);
+  stage1->info = __early_stage1_move (stage1->info);
+}
@@ -106,13 +106,206 @@ struct efi_memory_descriptor
 
 typedef uint64_t efi_uint_t;
 
+/*
+ * Stage 1 can pass its information to stage 2 in one of two ways.  The
+ * legacy way passes, in %rdi, %rsi, %rdx, %rcx, & %r8, a list of
+ * struct boot_reserve's, the number of entries in the list, the UEFI memory
+ * map, its size, & the size of each descriptor in it.  The video mode is
+ * passed as a reserved block named "video".
+ *
+ * The newer way passes, in %rdi, a pointer to a struct boot_info, which
+ * starts with BOOT_INFO_MAGIC.  (Under the legacy way, %rdi points to a
+ * struct boot_reserve, which starts with a pointer, & a valid pointer never
+ * looks like BOOT_INFO_MAGIC.)  The struct boot_info is followed by an
+ * index, which gives the offset & size of the data for each tag in
+ * enum boot_tag.  All offsets, including those inside the tag data, are
+ * relative to the start of the struct boot_info, so the whole block can be
+ * moved or mapped anywhere without fixing it up.
+ *
+ * New tags may be added to the end of enum boot_tag without changing
+ * BOOT_INFO_VERSION: stage 2 treats tags beyond the end of the index as
+ * absent, & ignores tags it does not know.  BOOT_INFO_VERSION changes only
+ * if the existing tags change incompatibly.
+ *
+ * The block, & everything it points to apart from the memory map, should be
+ * covered by BOOT_TAG_RESERVE entries, or else be outside of conventional
+ * memory, so that stage 2 does not hand them out before it is done with
+ * them.
+ */
+
+/** Magic number at the start of a struct boot_info: "BOOTINFO". */
+#define BOOT_INFO_MAGIC		0x4f464e49544f4f42
+/** Version of the struct boot_info layout. */
+#define BOOT_INFO_VERSION	1
+
+enum boot_tag
+{
+  /** struct boot_info_mem_map, followed by the UEFI memory map. */
+  BOOT_TAG_MEM_MAP,
+  /** struct boot_video. */
+  BOOT_TAG_VIDEO,
+  /** uint64_t physical address of the ACPI RSDP. */
+  BOOT_TAG_RSDP,
+  /** Kernel command line, as a NUL-terminated string. */
+  BOOT_TAG_CMDLINE,
+  /** Array of struct boot_info_range for the boot modules. */
+  BOOT_TAG_MODULES,
+  /** Array of struct boot_info_range for the reserved memory blocks. */
+  BOOT_TAG_RESERVE,
+  /** struct boot_info_page_tables. */
+  BOOT_TAG_PAGE_TABLES,
+  /** Array of struct boot_trace, in the order they were taken. */
+  BOOT_TAG_TRACE,
+  BOOT_TAG_MAX
+};
+
+struct boot_info_tag
+{
+  /** Offset of the tag data from the struct boot_info, or 0 if absent. */
+  uint32_t offset;
+  /** Size of the tag data in bytes. */
+  uint32_t size;
+};
+
+struct boot_info
+{
+  uint64_t magic;
+  uint16_t version;
+  /** Number of entries in tag[]. */
+  uint16_t tags;
+  /** Total size of the block in bytes, including tag data. */
+  uint32_t size;
+  struct boot_info_tag tag[];
+};
+
+struct boot_info_mem_map
+{
+  /** Size of each descriptor in the memory map which follows. */
+  uint64_t desc_size;
+};
+
+struct boot_info_range
+{
+  uint64_t begin;
+  uint64_t end;
+  /** Offset of a NUL-terminated name from the struct boot_info, or 0. */
+  uint32_t name;
+  uint32_t reserved;
+};
+
+/** struct boot_info_page_tables flag: the tables are for 5-level paging. */
+#define BOOT_PT_VA57		0x1
+
+/*
+ * Page tables which stage 1 has built for stage 2, so that stage 2 can
+ * start using them with a single load of %cr3.  The tables should map
+ * all the RAM in the memory map, & no memory-mapped I/O, at both BANE &
+ * the identity address, with write access.  direct_map_end should be at
+ * least the end of the highest RAM in the memory map.  Stage 2 later
+ * clears the lower half of the top-level table, to remove the identity
+ * mapping.
+ *
+ * The tables should be in memory which is not conventional memory.  Stage 2
+ * does not reclaim any pages which are still in use as page tables.
+ *
+ * If the tables do not meet these conditions, or were built for a
+ * different paging depth than the one in use, stage 2 ignores them & builds
+ * its own.
+ */
+struct boot_info_page_tables
+{
+  /** Value to load into %cr3. */
+  uint64_t cr3;
+  /** End of the physical memory mapped at BANE. */
+  uint64_t direct_map_end;
+  /** BOOT_PT_ flags. */
+  uint32_t flags;
+  uint32_t reserved;
+};
+
+/** Boot phases which stage 1 may time. */
+enum boot_phase
+{
+  /** Stage 1 started. */
+  BOOT_PHASE_LOADER_START,
+  /** Stage 2 image loaded into memory. */
+  BOOT_PHASE_IMAGE_LOADED,
+  /** UEFI memory map fetched. */
+  BOOT_PHASE_MEM_MAP,
+  /** ExitBootServices () returned. */
+  BOOT_PHASE_EXIT_BOOT_SERVICES,
+  BOOT_PHASE_MAX
+};
+
+/** Time stamp counter value at the end of a boot phase. */
+struct boot_trace
+{
+  uint64_t tsc;
+  /** enum boot_phase value. */
+  uint32_t phase;
+  uint32_t reserved;
+};
+
+/**
+ * Return a pointer to the data for tag TAG in the block INFO, & store its
+ * size in *SIZE.  Return NULL if the tag is absent.
+ */
+static inline const void *
+__boot_info_tag (const struct boot_info *__info, enum boot_tag __tag,
+		 size_t *__size)
+{
+  const struct boot_info_tag *__t;
+  if ((unsigned) __tag >= __info->tags)
+    return NULL;
+  __t = &__info->tag[__tag];
+  if (! __t->offset)
+    return NULL;
+  *__size = __t->size;
+  return (const char *) __info + __t->offset;
+}
+
+/**
+ * Information from stage 1, in whichever way it was passed, as seen by the
+ * rest of stage 2.  Absent items are NULL or 0.
+ */
 struct stage1
 {
-  struct boot_reserve *reserve;
-  size_t reserves;
+  /**
+   * Reserved memory blocks.  Entries are reserve_size bytes apart, which
+   * may be more than sizeof (struct boot_info_range); use
+   * __stage1_reserve (.) to get at them.
+   */
+  const struct boot_info_range *reserve;
+  size_t reserves, reserve_size;
   struct efi_memory_descriptor *mem_map;
   efi_uint_t mem_map_size;
   efi_uint_t mem_map_desc_size;
+  const struct boot_video *video;
+  uint64_t rsdp;
+  const char *cmdline;
+  const struct boot_info_range *module;
+  size_t modules;
+  /** Boot phase time stamps from stage 1. */
+  const struct boot_trace *trace;
+  size_t traces;
+  /** Page tables built by stage 1, if any. */
+  const struct boot_info_page_tables *page_tables;
+  /** The struct boot_info block, if stage 1 passed one. */
+  const struct boot_info *info;
 };
 
+/**
+ * Return a pointer to reserved memory block I in STAGE1.
+ */
+static inline const struct boot_info_range *
+__stage1_reserve (const struct stage1 *__stage1, size_t __i)
+{
+  return (const struct boot_info_range *)
+	 ((const char *) __stage1->reserve + __i * __stage1->reserve_size);
+}
+
+extern struct stage1 *__early_init_stage1 (uintptr_t, uintptr_t, uintptr_t,
+					   uintptr_t, uintptr_t);
+extern void __early_relocate_stage1 (struct stage1 *);
+
 #endif
@@ -0,0 +1,204 @@
+/*
+ * Copyright (c) 2023 TK Chia
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+/**
+ * @internal
+ * @fileoverview Time stamps for boot phases.
+ *
+ * Stage 1 & stage 2 each note the time stamp counter at the end of each
+ * boot phase.  Stage 2 copies stage 1's time stamps into its own buffer,
+ * & at the end of early initialization, writes out a table of how long
+ * each phase took, in cycles & in microseconds, to the kernel log.
+ *
+ * __early_trace (.) may be called before the switch to stage 2's own page
+ * tables, so it does nothing but store into the buffer.
+ */
+
+#include <inttypes.h>
+#include <stdio.h>
+#include "klog.h"
+#include "pc.h"
+#include "trace.h"
+#include "tsc.h"
+
+static struct
+  {
+    size_t n, lost;
+    struct boot_trace ent[TRACE_MAX];
+  } __trace;
+
+/**
+ * Note that boot phase PHASE ended when the time stamp counter read TSC.
+ */
+void
+__early_trace_at (unsigned phase, uint64_t tsc)
+{
+  struct boot_trace *t;
+  if (__trace.n == TRACE_MAX)
+    {
+      ++__trace.lost;
+      return;
+    }
+  t = &__trace.ent[__trace.n++];
+  t->tsc = tsc;
+  t->phase = phase;
+}
+
+/**
+ * Note that boot phase PHASE has just ended.
+ */
+void
+__early_trace (unsigned phase)
+{
+  __early_trace_at (phase, __read_tsc ());
+}
+
+/**
+ * Copy the time stamps which stage 1 passed in STAGE1 into the trace
+ * buffer.
+ */
+void
+__early_trace_stage1 (const struct stage1 *stage1)
+{
+  size_t i;
+  for (i = 0; i < stage1->traces; ++i)
+    __early_trace_at (stage1->trace[i].phase, stage1->trace[i].tsc);
+}
+
+/**
+ * @internal
+ * Return the name of boot phase PHASE, formatting it into the buffer of
+ * SIZE bytes at BUF if it has no name.  The dump runs after the switch to
+ * high memory, & stage 2 applies no relocations to itself, so the names
+ * come from a switch rather than from a table of pointers.
+ */
+static const char *
+__trace_name (unsigned phase, char *buf, size_t size)
+{
+  switch (phase)
+    {
+    case BOOT_PHASE_LOADER_START:
+      return "loader start";
+    case BOOT_PHASE_IMAGE_LOADED:
+      return "image loaded";
+    case BOOT_PHASE_MEM_MAP:
+      return "memory map";
+    case BOOT_PHASE_EXIT_BOOT_SERVICES:
+      return "ExitBootServices";
+    case TRACE_STAGE2_START:
+      return "stage 2 start";
+    case TRACE_PAGING_BUILT:
+      return "page tables built";
+    case TRACE_PAGING_SWITCHED:
+      return "page tables switched";
+    case TRACE_TSC:
+      return "TSC calibrated";
+    case TRACE_CONS:
+      return "console up";
+    case TRACE_KLOG:
+      return "kernel log up";
+    case TRACE_PAGE:
+      return "page allocator up";
+    case TRACE_RECLAIM:
+      return "memory reclaimed";
+    default:
+      snprintf (buf, size, "phase %#x", phase);
+      return buf;
+    }
+}
+
+static void
+__trace_sort (void)
+{
+  size_t i, j;
+  for (i = 1; i < __trace.n; ++i)
+    {
+      struct boot_trace t = __trace.ent[i];
+      for (j = i; j != 0 && __trace.ent[j - 1].tsc > t.tsc; --j)
+	__trace.ent[j] = __trace.ent[j - 1];
+      __trace.ent[j] = t;
+    }
+}
+
+static void
+__trace_row (const char *name, uint64_t cycles, uint64_t total)
+{
+  char msg[96];
+  int len;
+  if (__tsc_hz)
+    len = snprintf (msg, sizeof msg,
+		    "trace: %-22s %14" PRIu64 " %10" PRIu64 " %10" PRIu64 "\n",
+		    name, cycles, cycles * 1000000 / __tsc_hz,
+		    total * 1000000 / __tsc_hz);
+  else
+    len = snprintf (msg, sizeof msg, "trace: %-22s %14" PRIu64 " %10s %10s\n",
+		    name, cycles, "-", "-");
+  __klog_write (msg, (size_t) len);
+}
+
+/**
+ * @internal
+ * Write out how long it took from the last CPU reset to when the kernel
+ * log came up, i.e. when stage 2 could first say "hello world".  This
+ * assumes that the time stamp counter started from 0 at the reset, as it
+ * does under QEMU.
+ */
+static void
+__trace_hello (void)
+{
+  char msg[64];
+  int len;
+  size_t i;
+  if (! __tsc_hz)
+    return;
+  for (i = 0; i < __trace.n; ++i)
+    if (__trace.ent[i].phase == TRACE_KLOG)
+      {
+	len = snprintf (msg, sizeof msg,
+			"trace: hello world %" PRIu64 " us after reset\n",
+			__trace.ent[i].tsc * 1000000 / __tsc_hz);
+	__klog_write (msg, (size_t) len);
+	return;
+      }
+}
+
+/**
+ * Write a table of the boot phases timed so far to the kernel log, giving
+ * for each phase the cycles & microseconds it took, & the microseconds
+ * since the first time stamp.  The first phase is timed from its own end,
+ * since nothing came before it.  Then write out the time from reset to
+ * "hello world".
+ */
+void
+__early_trace_dump (void)
+{
+  char msg[96], buf[16];
+  int len;
+  size_t i;
+  if (! __trace.n)
+    return;
+  __trace_sort ();
+  len = snprintf (msg, sizeof msg,
+		  "trace: %-22s %14s %10s %10s\n",
+		  "phase", "cycles", "us", "total us");
+  __klog_write (msg, (size_t) len);
+  for (i = 0; i < __trace.n; ++i)
+    {
+      const struct boot_trace *t = &__trace.ent[i];
+      uint64_t prev = i ? __trace.ent[i - 1].tsc : t->tsc;
+      __trace_row (__trace_name (t->phase, buf, sizeof buf),
+		   t->tsc - prev, t->tsc - __trace.ent[0].tsc);
+    }
+  if (__trace.lost)
+    {
+      len = snprintf (msg, sizeof msg, "trace: %zu time stamps lost\n",
+		      __trace.lost);
+      __klog_write (msg, (size_t) len);
+    }
+  __trace_hello ();
+}
@@ -0,0 +1,42 @@
+/*
+ * Copyright (c) 2023 TK Chia
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+/**
+ * @internal Time stamps for boot phases.
+ */
+
+#ifndef _H_MACRON2_TRACE
+#define _H_MACRON2_TRACE
+
+/** Most time stamps which the trace buffer holds. */
+#define TRACE_MAX		64
+
+/*
+ * Boot phases timed by stage 2.  These follow on from stage 1's
+ * enum boot_phase in stage1.h.
+ */
+#define TRACE_STAGE2_START	0x100
+#define TRACE_PAGING_BUILT	0x101
+#define TRACE_PAGING_SWITCHED	0x102
+#define TRACE_TSC		0x103
+#define TRACE_CONS		0x104
+#define TRACE_KLOG		0x105
+#define TRACE_PAGE		0x106
+#define TRACE_RECLAIM		0x107
+
+#ifndef __ASSEMBLER__
+# include <stdint.h>
+# include "stage1.h"
+
+extern void __early_trace (unsigned);
+extern void __early_trace_at (unsigned, uint64_t);
+extern void __early_trace_stage1 (const struct stage1 *);
+extern void __early_trace_dump (void);
+#endif
+
+#endif
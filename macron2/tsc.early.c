@@ -0,0 +1,118 @@
+/*
+ * Copyright (c) 2023 TK Chia
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+/**
+ * @internal
+ * @fileoverview Work out the frequency of the time stamp counter.
+ *
+ * If the CPU reports its TSC & core crystal clock ratio, & the crystal
+ * frequency, via CPUID leaf 0x15, use that.  Failing that, use the
+ * processor base frequency from CPUID leaf 0x16, which the TSC runs at on
+ * CPUs which have that leaf, or the TSC frequency which a hypervisor
+ * reports in CPUID leaf 0x40000010.  Only as a last resort, time the TSC
+ * against a short one-shot countdown on channel 2 of the 8254 PIT, since
+ * this holds up booting.
+ */
+
+#include <cpuid.h>
+#include <stdbool.h>
+#include "pc.h"
+#include "tsc.h"
+
+/** Input clock frequency of the 8254 PIT, in Hz. */
+#define PIT_HZ		1193182U
+/** How long to run the PIT countdown for: 1 / TSC_CAL_DIV seconds. */
+#define TSC_CAL_DIV	200U
+/** CPUID leaf with the TSC frequency in kHz, under some hypervisors. */
+#define CPUID_HV_TSC	0x40000010U
+/** How many times to poll the PIT before deciding that it is not there. */
+#define TSC_CAL_TRIES	0x400000UL
+
+enum
+{
+  PIT_CH2 = 0x42,
+  PIT_MODE = 0x43,
+  PIT_CTL = 0x61,		/* NMI status & control register */
+  PIT_CTL_GATE2 = 1 << 0,
+  PIT_CTL_SPKR = 1 << 1,
+  PIT_CTL_OUT2 = 1 << 5
+};
+
+uint64_t __tsc_hz;
+
+static uint64_t
+__tsc_hz_from_cpuid (void)
+{
+  unsigned eax, ebx, ecx, edx;
+  if (__get_cpuid_max (0, NULL) < 0x15)
+    return 0;
+  __cpuid (0x15, eax, ebx, ecx, edx);
+  if (! eax || ! ebx || ! ecx)
+    return 0;
+  return (uint64_t) ecx * ebx / eax;
+}
+
+static uint64_t
+__tsc_hz_from_base (void)
+{
+  unsigned eax, ebx, ecx, edx;
+  if (__get_cpuid_max (0, NULL) < 0x16)
+    return 0;
+  __cpuid (0x16, eax, ebx, ecx, edx);
+  return (uint64_t) (eax & 0xffff) * 1000000;
+}
+
+static uint64_t
+__tsc_hz_from_hypervisor (void)
+{
+  unsigned eax, ebx, ecx, edx;
+  if (! __under_hypervisor ())
+    return 0;
+  __cpuid (0x40000000, eax, ebx, ecx, edx);
+  if (eax < CPUID_HV_TSC)
+    return 0;
+  __cpuid (CPUID_HV_TSC, eax, ebx, ecx, edx);
+  return (uint64_t) eax * 1000;
+}
+
+static uint64_t
+__tsc_hz_from_pit (void)
+{
+  uint16_t count = PIT_HZ / TSC_CAL_DIV;
+  uint8_t ctl = __inb (PIT_CTL);
+  unsigned long tries = TSC_CAL_TRIES;
+  uint64_t start, end;
+  /* Enable the channel 2 gate, but keep the speaker off. */
+  __outb (PIT_CTL, (ctl & ~PIT_CTL_SPKR) | PIT_CTL_GATE2);
+  /* Channel 2, low byte then high byte, mode 0 (one-shot), binary. */
+  __outb (PIT_MODE, 0xb0);
+  __outb (PIT_CH2, count & 0xff);
+  __outb (PIT_CH2, count >> 8);
+  start = __read_tsc ();
+  while ((__inb (PIT_CTL) & PIT_CTL_OUT2) == 0)
+    if (--tries == 0)
+      break;
+  end = __read_tsc ();
+  __outb (PIT_CTL, ctl);
+  if (! tries)
+    return 0;
+  return (end - start) * TSC_CAL_DIV;
+}
+
+void
+__early_init_tsc (void)
+{
+  uint64_t hz = __tsc_hz_from_cpuid ();
+  if (! hz)
+    hz = __tsc_hz_from_base ();
+  if (! hz)
+    hz = __tsc_hz_from_hypervisor ();
+  if (! hz)
+    hz = __tsc_hz_from_pit ();
+  __tsc_hz = hz;
+}
@@ -0,0 +1,26 @@
+/*
+ * Copyright (c) 2023 TK Chia
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+/**
+ * @internal Time stamp counter.
+ */
+
+#ifndef _H_MACRON2_TSC
+#define _H_MACRON2_TSC
+
+#include <stdint.h>
+
+/**
+ * Frequency of the time stamp counter in Hz, or 0 if this could not be
+ * worked out.
+ */
+extern uint64_t __tsc_hz;
+
+extern void __early_init_tsc (void);
+
+#endif